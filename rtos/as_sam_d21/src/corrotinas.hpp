@@ -0,0 +1,704 @@
+/*
+ * corrotinas.hpp
+ *
+ * Corrotinas C++20 (sem pilha propria) executadas dentro de uma unica tarefa
+ * do sistema multitarefas.
+ *
+ * Cada corrotina guarda apenas o seu quadro (variaveis que sobrevivem a um
+ * co_await), alocado em blocos de tamanho fixo de uma memoria estatica, e
+ * compartilha a pilha da tarefa que executa o Executor. Uma corrotina cede o
+ * processador somente nos pontos de co_await:
+ *
+ *   co_await Atraso(marcas);          espera marcas de tempo
+ *   co_await semaforo;                co::Semaforo, liberado por tarefas,
+ *                                     interrupcoes ou outras corrotinas
+ *   co_await AguardaSemaforo(sem);    semaforo_t do kernel, liberado por tarefas
+ *                                     ou interrupcoes
+ *   x = co_await fila.Recebe();       co::Fila<T, N>
+ *   co_await fila.Envia(x);
+ *
+ * Uso:
+ *
+ *   static rtos::co::Executor executor;
+ *
+ *   rtos::co::Corrotina sessao(uint8_t canal) { for(;;) { ... co_await ...; } }
+ *
+ *   void tarefa_corrotinas(void)
+ *   {
+ *       for(uint8_t i = 0; i < 100; i++) executor.Inicia(sessao(i));
+ *       executor.Executa();
+ *   }
+ *
+ * Quando nenhuma corrotina esta pronta, a tarefa do executor bloqueia com
+ * SemaforoAguardaQualquer() no seu semaforo de sinalizacao e nos semaforos do
+ * kernel esperados com AguardaSemaforo() (ate cfg_CORROTINA_SEMAFOROS_KERNEL
+ * semaforos distintos; os excedentes sao verificados a cada marca de tempo),
+ * com limite de tempo ate o Atraso() mais proximo.
+ *
+ * Requer C++20 (g++ 10 ou posterior com -std=c++20; no g++ 10 tambem
+ * -fcoroutines), sem excecoes e sem memoria dinamica.
+ */
+
+#ifndef CORROTINAS_HPP_
+#define CORROTINAS_HPP_
+
+#include <coroutine>
+#include <cstddef>
+#include "rtos.hpp"
+
+/* tamanho (em bytes, multiplo de 8) e numero dos blocos de memoria dos quadros
+   das corrotinas. O bloco deve comportar o maior quadro usado pela aplicacao
+   (ver MemoriaDeQuadros::MaiorQuadro()) */
+#ifndef cfg_CORROTINA_TAM_BLOCO
+#define cfg_CORROTINA_TAM_BLOCO		96
+#endif
+
+#ifndef cfg_CORROTINA_NUM_BLOCOS
+#define cfg_CORROTINA_NUM_BLOCOS	32
+#endif
+
+/* semaforos do kernel distintos esperados pela tarefa do executor ao mesmo
+   tempo (AguardaSemaforo) */
+#ifndef cfg_CORROTINA_SEMAFOROS_KERNEL
+#define cfg_CORROTINA_SEMAFOROS_KERNEL	4
+#endif
+
+namespace rtos
+{
+namespace co
+{
+
+class Executor;
+class Corrotina;
+
+/**
+* \class MemoriaDeQuadros
+* Blocos de tamanho fixo para os quadros das corrotinas. Os blocos nunca usados
+* sao tomados em ordem e os liberados formam uma lista, sem codigo de
+* inicializacao. Sem blocos livres, a corrotina criada e invalida.
+*/
+
+class MemoriaDeQuadros
+{
+	static_assert(cfg_CORROTINA_TAM_BLOCO % 8 == 0, "bloco deve ser multiplo de 8 bytes");
+
+public:
+	static void *Aloca(std::size_t tamanho)
+	{
+		RegiaoCritica r;
+		void *bloco = nullptr;
+
+		if(tamanho > maior_quadro)
+		{
+			maior_quadro = (uint16_t)tamanho;
+		}
+
+		if(tamanho > cfg_CORROTINA_TAM_BLOCO)
+		{
+			recusados++;
+		}
+		else if(livres != nullptr)
+		{
+			bloco = livres;
+			livres = livres->proximo;
+		}
+		else if(nunca_usados < cfg_CORROTINA_NUM_BLOCOS)
+		{
+			bloco = &blocos[nunca_usados++];
+		}
+		else
+		{
+			recusados++;
+		}
+
+		if(bloco != nullptr)
+		{
+			em_uso++;
+		}
+		return bloco;
+	}
+
+	static void Libera(void *quadro)
+	{
+		RegiaoCritica r;
+		Bloco *bloco = static_cast<Bloco *>(quadro);
+
+		bloco->proximo = livres;
+		livres = bloco;
+		em_uso--;
+	}
+
+	static uint16_t EmUso() { return em_uso; }
+	static uint16_t MaiorQuadro() { return maior_quadro; }	/* em bytes, inclusive os recusados */
+	static uint16_t Recusados() { return recusados; }
+
+private:
+	union Bloco
+	{
+		Bloco			*proximo;
+		alignas(8) uint8_t	dados[cfg_CORROTINA_TAM_BLOCO];
+	};
+
+	static inline Bloco		blocos[cfg_CORROTINA_NUM_BLOCOS];
+	static inline Bloco		*livres = nullptr;
+	static inline uint16_t	nunca_usados = 0;
+	static inline uint16_t	em_uso = 0;
+	static inline uint16_t	maior_quadro = 0;
+	static inline uint16_t	recusados = 0;
+};
+
+/**
+* \struct Promessa
+* Estado de uma corrotina visto pelo executor: listas de prontas, de espera
+* por tempo e de espera por semaforo (uma corrotina esta em no maximo uma)
+*/
+
+struct Promessa
+{
+	Executor	*executor = nullptr;
+	Promessa	*proximo = nullptr;
+	tick_t		despertar = 0;				/* Atraso(): marca de tempo do despertar */
+	semaforo_t	*sem_kernel = nullptr;		/* AguardaSemaforo(): semaforo esperado */
+
+	Corrotina get_return_object();
+	static Corrotina get_return_object_on_allocation_failure();
+
+	std::suspend_always initial_suspend() noexcept { return {}; }
+	std::suspend_always final_suspend() noexcept { return {}; }
+	void return_void() {}
+	void unhandled_exception() { for(;;) {} }
+
+	static void *operator new(std::size_t tamanho) noexcept { return MemoriaDeQuadros::Aloca(tamanho); }
+	static void operator delete(void *quadro) { MemoriaDeQuadros::Libera(quadro); }
+
+	std::coroutine_handle<Promessa> Handle() { return std::coroutine_handle<Promessa>::from_promise(*this); }
+};
+
+/**
+* \class Corrotina
+* Tipo de retorno das funcoes de corrotina. A corrotina criada fica suspensa
+* ate ser entregue ao executor com Executor::Inicia()
+*/
+
+class Corrotina
+{
+public:
+	using promise_type = Promessa;
+
+	explicit Corrotina(std::coroutine_handle<Promessa> h = nullptr) : handle(h) {}
+	Corrotina(Corrotina &&outra) : handle(outra.handle) { outra.handle = nullptr; }
+	~Corrotina()
+	{
+		if(handle)
+		{
+			handle.destroy();	/* criada e nunca iniciada */
+		}
+	}
+
+	bool Valida() const { return static_cast<bool>(handle); }
+
+	Corrotina(const Corrotina &) = delete;
+	Corrotina &operator=(const Corrotina &) = delete;
+
+private:
+	friend class Executor;
+	std::coroutine_handle<Promessa> handle;
+};
+
+inline Corrotina Promessa::get_return_object() { return Corrotina(Handle()); }
+inline Corrotina Promessa::get_return_object_on_allocation_failure() { return Corrotina(); }
+
+/**
+* \class Executor
+* Executa as corrotinas prontas, em ordem de chegada, dentro da tarefa que
+* chama Executa(). Pronta() pode ser chamada por tarefas e interrupcoes (com
+* REG_ATOMICA_ISR_INICIO e SemaforoLiberaISR(); a rotina de interrupcao
+* termina com FIM_DE_INTERRUPCAO()); as demais funcoes somente pela tarefa do
+* executor.
+*/
+
+class Executor
+{
+public:
+	constexpr Executor() : sinal{0, 0, 0} {}
+
+	/* entrega uma corrotina criada ao executor; falso se ela e invalida
+	   (sem memoria para o quadro) */
+	bool Inicia(Corrotina &&c)
+	{
+		Promessa *p;
+
+		if(!c.handle)
+		{
+			return false;
+		}
+		p = &c.handle.promise();
+		c.handle = nullptr;
+		p->executor = this;
+		ativas++;
+		Pronta(p);
+		return true;
+	}
+
+	/* corpo da tarefa do executor, nunca retorna */
+	void Executa()
+	{
+		semaforo_t *espera[1 + cfg_CORROTINA_SEMAFOROS_KERNEL];
+
+		for(;;)
+		{
+			Promessa *p;
+			tick_t marcas;
+			uint8_t numero, indice;
+
+			while((p = RetiraPronta()) != nullptr)
+			{
+				std::coroutine_handle<Promessa> h = p->Handle();
+
+				h.resume();
+				if(h.done())
+				{
+					h.destroy();
+					ativas--;
+				}
+			}
+
+			VerificaAtrasos();
+
+			if(prontas != nullptr)
+			{
+				continue;
+			}
+
+			numero = PreparaEspera(espera, marcas);
+			if(numero != 0 &&
+			   SemaforoAguardaQualquer(espera, numero, marcas, &indice) == STATUS_OK)
+			{
+				if(indice == 0)
+				{
+					sinal_pendente = 0;
+				}
+				else
+				{
+					EntregaSemaforo(espera[indice]);
+				}
+			}
+		}
+	}
+
+	/* coloca a corrotina no fim da lista de prontas e acorda a tarefa do executor */
+	void Pronta(Promessa *p)
+	{
+		REG_ATOMICA_ISR_INICIO(estado);
+
+		p->proximo = nullptr;
+		if(prontas == nullptr)
+		{
+			prontas = p;
+		}
+		else
+		{
+			ultima_pronta->proximo = p;
+		}
+		ultima_pronta = p;
+
+		if(!sinal_pendente)
+		{
+			sinal_pendente = 1;
+			if(EM_INTERRUPCAO())
+			{
+				(void)SemaforoLiberaISR(&sinal);
+			}
+			else
+			{
+				(void)SemaforoLibera(&sinal);
+			}
+		}
+
+		REG_ATOMICA_ISR_FIM(estado);
+	}
+
+	void Atrasa(Promessa *p, tick_t marcas)
+	{
+		p->despertar = (tick_t)(MarcasDeTempo() + marcas);
+		p->proximo = atrasadas;
+		atrasadas = p;
+	}
+
+	/* espera o semaforo do kernel, obtido pela tarefa do executor */
+	void EsperaSemaforo(Promessa *p, semaforo_t *sem)
+	{
+		Promessa **pp = &aguardam_semaforo;
+
+		while(*pp != nullptr)
+		{
+			pp = &(*pp)->proximo;
+		}
+		p->sem_kernel = sem;
+		p->proximo = nullptr;
+		*pp = p;
+	}
+
+	uint16_t Ativas() const { return ativas; }
+
+	Executor(const Executor &) = delete;
+	Executor &operator=(const Executor &) = delete;
+
+private:
+	Promessa *RetiraPronta()
+	{
+		RegiaoCritica r;
+		Promessa *p = prontas;
+
+		if(p != nullptr)
+		{
+			prontas = p->proximo;
+		}
+		return p;
+	}
+
+	/* despertar vencido (tick_t retorna a zero): atrasos de ate metade do tick_t */
+	static bool Venceu(tick_t despertar, tick_t agora)
+	{
+		return (tick_t)(agora - despertar) < (tick_t)(MARCAS_INDEFINIDAS / 2);
+	}
+
+	void VerificaAtrasos()
+	{
+		tick_t agora = MarcasDeTempo();
+		Promessa **pp = &atrasadas;
+
+		while(*pp != nullptr)
+		{
+			Promessa *p = *pp;
+
+			if(Venceu(p->despertar, agora))
+			{
+				*pp = p->proximo;
+				Pronta(p);
+			}
+			else
+			{
+				pp = &p->proximo;
+			}
+		}
+	}
+
+	/* entrega a unidade obtida do semaforo do kernel a corrotina mais antiga
+	   que o espera */
+	void EntregaSemaforo(semaforo_t *sem)
+	{
+		Promessa **pp = &aguardam_semaforo;
+
+		while(*pp != nullptr && (*pp)->sem_kernel != sem)
+		{
+			pp = &(*pp)->proximo;
+		}
+
+		if(*pp != nullptr)
+		{
+			Promessa *p = *pp;
+
+			*pp = p->proximo;
+			p->sem_kernel = nullptr;
+			Pronta(p);
+		}
+		else
+		{
+			(void)SemaforoLibera(sem);
+		}
+	}
+
+	/* monta o vetor de semaforos da espera da tarefa do executor: o sinal das
+	   prontas e os semaforos do kernel esperados, sem repeticao, e o limite de
+	   tempo ate o proximo Atraso() (0: sem limite). Os semaforos que nao cabem
+	   no vetor sao verificados aqui, uma vez por marca; retorna 0 se um deles
+	   foi obtido */
+	uint8_t PreparaEspera(semaforo_t **espera, tick_t &marcas)
+	{
+		tick_t agora = MarcasDeTempo();
+		uint8_t numero = 1;
+
+		espera[0] = &sinal;
+		marcas = 0;
+
+		for(Promessa *p = aguardam_semaforo; p != nullptr; p = p->proximo)
+		{
+			uint8_t i;
+
+			for(i = 1; i < numero && espera[i] != p->sem_kernel; i++)
+			{
+			}
+
+			if(i < numero)
+			{
+				continue;
+			}
+			if(numero <= cfg_CORROTINA_SEMAFOROS_KERNEL)
+			{
+				espera[numero++] = p->sem_kernel;
+			}
+			else if(SemaforoTentaAguardar(p->sem_kernel) == STATUS_OK)
+			{
+				EntregaSemaforo(p->sem_kernel);
+				return 0;
+			}
+			else
+			{
+				marcas = 1;
+			}
+		}
+
+		for(Promessa *p = atrasadas; p != nullptr; p = p->proximo)
+		{
+			tick_t falta = Venceu(p->despertar, agora) ? 1 : (tick_t)(p->despertar - agora);
+
+			if(marcas == 0 || falta < marcas)
+			{
+				marcas = falta;
+			}
+		}
+
+		return numero;
+	}
+
+	Promessa			*prontas = nullptr;
+	Promessa			*ultima_pronta = nullptr;
+	Promessa			*atrasadas = nullptr;
+	Promessa			*aguardam_semaforo = nullptr;	/* AguardaSemaforo(), em ordem de chegada */
+	semaforo_t			sinal;					/* tarefa do executor bloqueada sem corrotinas prontas */
+	volatile uint8_t	sinal_pendente = 0;
+	uint16_t			ativas = 0;
+};
+
+/**
+* \struct Atraso
+* co_await Atraso(marcas): suspende a corrotina por marcas de tempo
+*/
+
+struct Atraso
+{
+	tick_t marcas;
+
+	explicit Atraso(tick_t m) : marcas(m) {}
+
+	bool await_ready() const noexcept { return marcas == 0; }
+	void await_suspend(std::coroutine_handle<Promessa> h) noexcept
+	{
+		h.promise().executor->Atrasa(&h.promise(), marcas);
+	}
+	void await_resume() const noexcept {}
+};
+
+/**
+* \struct AguardaSemaforo
+* co_await AguardaSemaforo(sem): obtem um semaforo_t do kernel, liberado por
+* tarefas ou interrupcoes com SemaforoLibera(). A tarefa do executor espera o
+* semaforo junto com o seu sinal (SemaforoAguardaQualquer) e entrega a unidade
+* obtida a corrotina mais antiga que o aguarda; para sincronizar corrotinas
+* entre si, preferir co::Semaforo.
+*/
+
+struct AguardaSemaforo
+{
+	semaforo_t *sem;
+
+	explicit AguardaSemaforo(semaforo_t &s) : sem(&s) {}
+
+	bool await_ready() const noexcept { return SemaforoTentaAguardar(sem) == STATUS_OK; }
+	void await_suspend(std::coroutine_handle<Promessa> h) noexcept
+	{
+		h.promise().executor->EsperaSemaforo(&h.promise(), sem);
+	}
+	void await_resume() const noexcept {}
+};
+
+/**
+* \class Semaforo
+* Semaforo contador para corrotinas. Libera() e TentaAguardar() podem ser
+* chamadas por tarefas, interrupcoes ou corrotinas (regioes criticas com
+* REG_ATOMICA_ISR_INICIO); a corrotina mais antiga em espera recebe o
+* semaforo e vai para a lista de prontas do seu executor.
+*/
+
+class Semaforo
+{
+public:
+	constexpr explicit Semaforo(uint16_t inicial = 0) : contador(inicial) {}
+
+	struct Aguardador
+	{
+		Semaforo &sem;
+
+		bool await_ready() noexcept { return sem.TentaAguardar(); }
+		bool await_suspend(std::coroutine_handle<Promessa> h) noexcept
+		{
+			RegiaoCritica r;
+
+			if(sem.contador > 0)
+			{
+				sem.contador--;		/* liberado depois de await_ready() */
+				return false;
+			}
+			h.promise().proximo = nullptr;
+			if(sem.esperando == nullptr)
+			{
+				sem.esperando = &h.promise();
+			}
+			else
+			{
+				sem.ultimo->proximo = &h.promise();
+			}
+			sem.ultimo = &h.promise();
+			return true;
+		}
+		void await_resume() noexcept {}
+	};
+
+	Aguardador operator co_await() noexcept { return Aguardador{*this}; }
+
+	bool TentaAguardar()
+	{
+		bool obtido = false;
+		REG_ATOMICA_ISR_INICIO(estado);
+
+		if(contador > 0)
+		{
+			contador--;
+			obtido = true;
+		}
+
+		REG_ATOMICA_ISR_FIM(estado);
+		return obtido;
+	}
+
+	void Libera()
+	{
+		REG_ATOMICA_ISR_INICIO(estado);
+		Promessa *p = esperando;
+
+		if(p != nullptr)
+		{
+			esperando = p->proximo;
+			p->executor->Pronta(p);
+		}
+		else
+		{
+			contador++;
+		}
+
+		REG_ATOMICA_ISR_FIM(estado);
+	}
+
+	uint16_t Contador() const { return contador; }
+
+	Semaforo(const Semaforo &) = delete;
+	Semaforo &operator=(const Semaforo &) = delete;
+
+private:
+	uint16_t			contador;		/* acessado somente em regioes criticas */
+	Promessa			*esperando = nullptr;
+	Promessa			*ultimo = nullptr;
+};
+
+/**
+* \class Fila
+* Fila de N elementos do tipo T para corrotinas, com um semaforo para as
+* posicoes livres e outro para as ocupadas, como rtos::Fila. Tarefas e
+* interrupcoes usam TentaEnviar()/TentaReceber(), que nao bloqueiam.
+*/
+
+template <typename T, uint8_t N>
+class Fila
+{
+	static_assert(N > 0, "fila sem elementos");
+
+public:
+	constexpr Fila() : livres(N), ocupadas(0), buffer{} {}
+
+	struct Envio
+	{
+		Fila				&fila;
+		T					item;
+		Semaforo::Aguardador espera;
+
+		bool await_ready() noexcept { return espera.await_ready(); }
+		bool await_suspend(std::coroutine_handle<Promessa> h) noexcept { return espera.await_suspend(h); }
+		void await_resume() noexcept { fila.Insere(item); }
+	};
+
+	struct Recepcao
+	{
+		Fila				&fila;
+		Semaforo::Aguardador espera;
+
+		bool await_ready() noexcept { return espera.await_ready(); }
+		bool await_suspend(std::coroutine_handle<Promessa> h) noexcept { return espera.await_suspend(h); }
+		T await_resume() noexcept { return fila.Retira(); }
+	};
+
+	Envio Envia(const T &item) { return Envio{*this, item, Semaforo::Aguardador{livres}}; }
+	Recepcao Recebe() { return Recepcao{*this, Semaforo::Aguardador{ocupadas}}; }
+
+	bool TentaEnviar(const T &item)
+	{
+		if(!livres.TentaAguardar())
+		{
+			return false;
+		}
+		Insere(item);
+		return true;
+	}
+
+	bool TentaReceber(T &item)
+	{
+		if(!ocupadas.TentaAguardar())
+		{
+			return false;
+		}
+		item = Retira();
+		return true;
+	}
+
+	uint16_t Quantidade() const { return ocupadas.Contador(); }
+
+	Fila(const Fila &) = delete;
+	Fila &operator=(const Fila &) = delete;
+
+private:
+	void Insere(const T &item)
+	{
+		{
+			REG_ATOMICA_ISR_INICIO(estado);
+			buffer[fim] = item;
+			fim = (uint8_t)((fim + 1) % N);
+			REG_ATOMICA_ISR_FIM(estado);
+		}
+		ocupadas.Libera();
+	}
+
+	T Retira()
+	{
+		T item;
+
+		{
+			REG_ATOMICA_ISR_INICIO(estado);
+			item = buffer[inicio];
+			inicio = (uint8_t)((inicio + 1) % N);
+			REG_ATOMICA_ISR_FIM(estado);
+		}
+		livres.Libera();
+		return item;
+	}
+
+	Semaforo	livres;
+	Semaforo	ocupadas;
+	T			buffer[N];
+	uint8_t		inicio = 0;
+	uint8_t		fim = 0;
+};
+
+} /* namespace co */
+} /* namespace rtos */
+
+#endif /* CORROTINAS_HPP_ */
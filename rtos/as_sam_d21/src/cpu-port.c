@@ -8,6 +8,8 @@
 #include "cpu-port.h"
 #include "rtos.h"
 
+extern stackptr_t SP;		/* ponteiro de pilha salvo/restaurado no PendSV (rtos.c) */
+
 stackptr_t CriaContexto(tarefa_t endereco_tarefa, stackptr_t ptr_pilha)
 {
 	#define INITIAL_XPSR		0x01000000
@@ -41,6 +43,167 @@ stackptr_t CriaContexto(tarefa_t endereco_tarefa, stackptr_t ptr_pilha)
 	
 }
 
+/* Chamada aninhada: executa em modo thread, na pilha da tarefa, a funcao
+   passada em R0 pelo quadro empilhado. O SVC descarta o quadro do proprio SVC
+   e o retorno de excecao restaura o quadro do codigo interrompido; R4-R11
+   sao preservados pela funcao chamada */
+__attribute__ ((naked)) static void ChamadaAninhada(void)
+{
+	__asm volatile(
+					"BLX     R0				\n"
+					"SVC     1				\n"
+					"B       .				\n"
+				);
+}
+
+/* Gancho padrao do fim do PendSV: a tarefa continua do ponto interrompido.
+   Redefinido por tarefa-basica.c */
+__attribute__((weak)) stackptr_t TrocaContextoFimGancho(stackptr_t pilha)
+{
+	return pilha;
+}
+
+/* Empilha um quadro de excecao entre os registradores R4-R11 salvos pelo
+   PendSV e o quadro da excecao interrompida, que esta alinhado a 8 bytes: o
+   novo quadro tambem fica alinhado e o seu xPSR nao indica palavra de
+   alinhamento. Ao sair do PendSV a tarefa executa ChamadaAninhada(funcao) */
+stackptr_t EmpilhaChamadaAninhada(stackptr_t pilha, void (*funcao)(void))
+{
+	stackptr_t nova = pilha - 8;
+	uint8_t i;
+	
+	for(i = 0; i < 8; i++)
+	{
+		nova[i] = pilha[i];		/* R8-R11, R4-R7 */
+	}
+	
+	nova[8] = (uint32_t)funcao;			/* R0 */
+	nova[9] = 0;						/* R1 */
+	nova[10] = 0;						/* R2 */
+	nova[11] = 0;						/* R3 */
+	nova[12] = 0;						/* R12 */
+	nova[13] = 0;						/* R14 */
+	nova[14] = (uint32_t)ChamadaAninhada & ~1UL;	/* R15, sem o bit Thumb */
+	nova[15] = 0x01000000;				/* xPSR */
+	
+	return nova;
+}
+
+/* Regioes criticas aninhaveis */
+static volatile uint32_t aninhamento_critico = 0;	/* nivel de aninhamento */
+static volatile uint32_t primask_salvo;			/* PRIMASK antes da regiao mais externa */
+
+#if cfg_MEDE_REGIAO_CRITICA
+uint32_t	regiao_critica_max_ciclos = 0;
+const void	*regiao_critica_max_origem = NULL;
+
+static uint32_t		regiao_critica_inicio;
+static const void	*regiao_critica_origem;
+#endif
+
+void EntraRegiaoCritica(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	
+	__disable_irq();
+	
+	if(aninhamento_critico == 0)
+	{
+		primask_salvo = primask;
+		
+#if cfg_MEDE_REGIAO_CRITICA
+		regiao_critica_origem = __builtin_return_address(0);
+		regiao_critica_inicio = LE_CONTADOR_CICLOS();
+#endif
+	}
+	aninhamento_critico++;
+}
+
+void SaiRegiaoCritica(void)
+{
+	if(aninhamento_critico > 0)
+	{
+		aninhamento_critico--;
+		
+		if(aninhamento_critico == 0)
+		{
+#if cfg_MEDE_REGIAO_CRITICA
+			/* so mede se as interrupcoes estavam habilitadas antes da regiao;
+			   valido para regioes menores que um periodo da marca de tempo */
+			uint32_t ciclos = CICLOS_DECORRIDOS(regiao_critica_inicio, LE_CONTADOR_CICLOS());
+			if(primask_salvo == 0 && ciclos > regiao_critica_max_ciclos)
+			{
+				regiao_critica_max_ciclos = ciclos;
+				regiao_critica_max_origem = regiao_critica_origem;
+			}
+#endif
+			__set_PRIMASK(primask_salvo);
+		}
+	}
+}
+
+/* nivel de aninhamento da regiao critica atual (0: fora de regiao critica) */
+uint32_t RegiaoCriticaAninhamento(void)
+{
+	return aninhamento_critico;
+}
+
+#if cfg_OCIOSA_BAIXO_CONSUMO
+/* Modo de baixo consumo da tarefa ociosa */
+estatistica_sono_t EstatisticasSono[NUMERO_MODOS_SONO];
+
+/* Chamada com as interrupcoes desabilitadas: o WFI retorna quando uma interrupcao
+   fica pendente e ela e atendida ao sair da regiao critica */
+void OciosaDorme(tick_t marcas_livres)
+{
+	enum system_sleepmode modo = SYSTEM_SLEEPMODE_IDLE_0;
+	uint32_t inicio, fim;
+#if cfg_MEDE_REGIAO_CRITICA
+	uint32_t decorridos;
+#endif
+	
+	if(cfg_OCIOSA_PERMITE_STANDBY && marcas_livres == MARCAS_INDEFINIDAS)
+	{
+		modo = SYSTEM_SLEEPMODE_STANDBY;
+	}
+#if cfg_OCIOSA_MARCAS_IDLE_2
+	else if(marcas_livres >= cfg_OCIOSA_MARCAS_IDLE_2)
+	{
+		modo = SYSTEM_SLEEPMODE_IDLE_2;
+	}
+#endif
+	else if(marcas_livres >= cfg_OCIOSA_MARCAS_IDLE_1)
+	{
+		modo = SYSTEM_SLEEPMODE_IDLE_1;
+	}
+	
+	system_set_sleepmode(modo);
+	
+	inicio = LE_CONTADOR_CICLOS();
+#if cfg_MEDE_REGIAO_CRITICA
+	decorridos = CICLOS_DECORRIDOS(regiao_critica_inicio, inicio);
+#endif
+	system_sleep();
+	fim = LE_CONTADOR_CICLOS();
+	
+#if cfg_MEDE_REGIAO_CRITICA
+	/* o WFI retorna assim que uma interrupcao fica pendente, logo o sono nao
+	   atrasa interrupcoes: a medicao da regiao critica da tarefa ociosa fica
+	   pausada durante o sono e continua com os ciclos ja decorridos */
+	regiao_critica_inicio = fim + decorridos;
+	if(regiao_critica_inicio > *(NVIC_SYSTICK_LOAD))
+	{
+		regiao_critica_inicio -= *(NVIC_SYSTICK_LOAD) + 1;
+	}
+#endif
+	
+	/* a marca de tempo acorda o processador, logo cada periodo de sono dura no
+	   maximo um recarregamento do SysTick (exceto em STANDBY, quando ele para) */
+	EstatisticasSono[modo].entradas++;
+	EstatisticasSono[modo].ciclos += CICLOS_DECORRIDOS(inicio, fim);
+}
+#endif
+
 /* Codigo dependente de hardware usado para 
  * configuracao da marca de tempo do sistema multitarefas */
 void ConfiguraMarcaTempo(void)
@@ -57,6 +220,20 @@ void ConfiguraMarcaTempo(void)
 /* rotinas de interrupcao necessarias */
 __attribute__ ((naked)) void SVC_Handler(void)
 {
+	/* SVC de uma tarefa (EXC_RETURN com PSP): fim de uma chamada aninhada,
+	   descarta o quadro do SVC e retorna ao quadro interrompido */
+	__asm volatile(
+					"MOV     R0, LR			\n"
+					"MOVS    R1, #4			\n"
+					"TST     R0, R1			\n"
+					"BEQ     1f				\n"
+					"MRS     R0, PSP		\n"
+					"ADDS    R0, #0x20		\n"
+					"MSR     PSP, R0		\n"
+					"BX      LR				\n"
+					"1:						\n"
+				);
+	
 	/* Make PendSV and SysTick the lowest priority interrupts. */
 	*(NVIC_SYSPRI3) |= NVIC_PENDSV_PRI;
 	*(NVIC_SYSPRI3) |= NVIC_SYSTICK_PRI;
@@ -75,6 +252,7 @@ __attribute__ ((naked)) void PendSV_Handler(void)
 	Clear_PendSV();
 	
     TrocaContextoDasTarefas();
+	SP = TrocaContextoFimGancho(SP);
 	
 	RESTAURA_SP(SP);
 	RESTAURA_CONTEXTO();
@@ -87,8 +265,23 @@ __attribute__ ((naked)) void PendSV_Handler(void)
 void SysTick_Handler(void)
 {	
 	 
+#if cfg_MEDE_CUSTOS
+	 uint32_t inicio = LE_CONTADOR_CICLOS();
+	 uint32_t custo;
+#endif
+
 	 ExecutaMarcaDeTempo();    
-	 //TrocaContexto();   /* para o uso como sistema preemptivo */
+
+#if cfg_MEDE_CUSTOS
+	 custo = CICLOS_DECORRIDOS(inicio, LE_CONTADOR_CICLOS());
+	 if(custo > custo_max_marca_tempo)
+	 {
+		 custo_max_marca_tempo = custo;
+	 }
+#endif
+#if cfg_PREEMPCAO_NA_MARCA
+	 TrocaContexto();   /* para o uso como sistema preemptivo */
+#endif
 }
 
 void HardFault_Handler(void)
@@ -23,12 +23,16 @@ typedef uint32_t* stackptr_t;
 #define NVIC_SYSPRI3			( ( volatile unsigned long *) 0xe000ed20 )
 #define NVIC_SYSTICK_CTRL       ( ( volatile unsigned long *) 0xe000e010 )
 #define NVIC_SYSTICK_LOAD       ( ( volatile unsigned long *) 0xe000e014 )
+#define NVIC_SYSTICK_VAL        ( ( volatile unsigned long *) 0xe000e018 )
+#define NVIC_AIRCR              ( ( volatile unsigned long *) 0xe000ed0c )
 
 #define NVIC_PENDSVSET      			0x10000000         			// Dispara excecao PendSV
 #define NVIC_PENDSVCLR      			0x08000000         			// Limpa a flag PendSV
 #define NVIC_SYSTICK_CLK        		0x00000004
 #define NVIC_SYSTICK_INT        		0x00000002
 #define NVIC_SYSTICK_ENABLE     		0x00000001
+#define NVIC_AIRCR_VECTKEY				0x05FA0000					// Chave de escrita do AIRCR
+#define NVIC_AIRCR_SYSRESETREQ			0x00000004					// Solicita reinicio do sistema
 #define PRIO_BITS       		        4        					// 15 niveis de prioridade
 #define LOWEST_INTERRUPT_PRIORITY		0xF
 #define KERNEL_INTERRUPT_PRIORITY 		(LOWEST_INTERRUPT_PRIORITY << (8 - PRIO_BITS) )
@@ -36,14 +40,56 @@ typedef uint32_t* stackptr_t;
 #define NVIC_SYSTICK_PRI				( ( ( unsigned long ) KERNEL_INTERRUPT_PRIORITY ) << 24 )
 
 
-/* macros dependentes de hardware, instrucoes em assembly */
-#define REG_ATOMICA_INICIO()  	  __asm(" CPSID I");
-#define REG_ATOMICA_FIM()  		  __asm(" CPSIE I");
-
-#define TROCA_CONTEXTO()		*(NVIC_INT_CTRL_B) = NVIC_PENDSVSET; __asm(" CPSIE I");
+/* regioes criticas aninhaveis: a primeira entrada salva o PRIMASK e desabilita
+   as interrupcoes, a ultima saida restaura o PRIMASK salvo */
+#ifdef __cplusplus
+extern "C" {
+#endif
+void EntraRegiaoCritica(void);
+void SaiRegiaoCritica(void);
+uint32_t RegiaoCriticaAninhamento(void);
+
+/* chamada aninhada na pilha da tarefa que vai continuar (tarefa-basica.c): no
+   fim do PendSV, TrocaContextoFimGancho() recebe o ponteiro de pilha salvo e
+   pode retorna-lo com EmpilhaChamadaAninhada(), que faz a tarefa executar
+   funcao e so depois voltar ao codigo interrompido */
+stackptr_t TrocaContextoFimGancho(stackptr_t pilha);
+stackptr_t EmpilhaChamadaAninhada(stackptr_t pilha, void (*funcao)(void));
+#ifdef __cplusplus
+}
+#endif
+
+/* macros dependentes de hardware */
+#define REG_ATOMICA_INICIO()  	  EntraRegiaoCritica();
+#define REG_ATOMICA_FIM()  		  SaiRegiaoCritica();
+
+/* chamado dentro da regiao critica de um servico: ha outra regiao aberta por
+   fora, que mantem as interrupcoes (e a troca de contexto) desabilitadas */
+#define REG_ATOMICA_ANINHADA()	(RegiaoCriticaAninhamento() > 1)
+
+/* regiao critica das rotinas de interrupcao (servicos ...ISR): salva o PRIMASK
+   em uma variavel local, sem o contador de aninhamento nem a medicao das regioes
+   das tarefas, e pode ser usada em interrupcoes aninhadas */
+#define REG_ATOMICA_ISR_INICIO(estado)	uint32_t estado = __get_PRIMASK(); __disable_irq();
+#define REG_ATOMICA_ISR_FIM(estado)		__set_PRIMASK(estado);
+
+/* a troca de contexto solicitada ocorre quando as interrupcoes forem habilitadas,
+   isto e, ao sair da regiao critica mais externa */
+#define TROCA_CONTEXTO()		*(NVIC_INT_CTRL_B) = NVIC_PENDSVSET;
 #define TrocaContexto()		    TROCA_CONTEXTO()
 #define Clear_PendSV(void)		*(NVIC_INT_CTRL_B) = NVIC_PENDSVCLR
 
+/* executando uma rotina de interrupcao (numero da excecao ativa no IPSR) */
+#define EM_INTERRUPCAO()		(__get_IPSR() != 0)
+
+#define REINICIA_SISTEMA()		*(NVIC_AIRCR) = NVIC_AIRCR_VECTKEY | NVIC_AIRCR_SYSRESETREQ; while(1){}
+
+/* leitura do contador do SysTick (conta de forma decrescente a cada ciclo de clock da CPU) */
+#define LE_CONTADOR_CICLOS()		(*(NVIC_SYSTICK_VAL))
+
+/* ciclos decorridos entre duas leituras do contador, considerando no maximo um recarregamento */
+#define CICLOS_DECORRIDOS(ini, fim)	(((ini) >= (fim)) ? ((ini) - (fim)) : ((ini) + *(NVIC_SYSTICK_LOAD) + 1 - (fim)))
+
 #define GERA_INTERRUPCAO_SW()      __asm(  /* Call SVC to start the first task. */		\
 										"cpsie i				\n"					\
 										"svc 0					\n"					\
@@ -41,6 +41,21 @@ void tarefa_6(void);
 void tarefa_7(void);
 void tarefa_8(void);
 void tarefa_9(void);
+void tarefa_10(void);
+void tarefa_11(void);
+void tarefa_12(void);
+void tarefa_13(void);
+
+/* medicao do tempo entre a sinalizacao e o despertar de uma tarefa, com
+   semaforo e com notificacao direta (tarefa_12 e tarefa_13). As tarefas 12 e
+   13 ocupam as prioridades 4 e 3 no lugar das tarefas 1 e 2, dentro de
+   NUMERO_DE_TAREFAS e PRIORIDADE_MAXIMA do kernel */
+#define MEDE_SINALIZACAO	0
+#define PRIORIDADE_MEDIDA	4
+
+/* exemplo do buffer compartilhado com mutex e variaveis de condicao: as
+   tarefas 10 e 11 ocupam as prioridades 2 e 1 no lugar das tarefas 1 e 2 */
+#define EXEMPLO_MUTEX_CONDICAO	0
 
 /*
  * Configuracao dos tamanhos das pilhas
@@ -54,8 +69,24 @@ void tarefa_9(void);
 #define TAM_PILHA_7			(TAM_MINIMO_PILHA + 24)
 #define TAM_PILHA_8			(TAM_MINIMO_PILHA + 24)
 #define TAM_PILHA_9			(TAM_MINIMO_PILHA + 24)
+#define TAM_PILHA_10		(TAM_MINIMO_PILHA + 24)
+#define TAM_PILHA_11		(TAM_MINIMO_PILHA + 24)
+#define TAM_PILHA_12		(TAM_MINIMO_PILHA + 24)
+#define TAM_PILHA_13		(TAM_MINIMO_PILHA + 24)
 #define TAM_PILHA_OCIOSA	(TAM_MINIMO_PILHA + 24)
 
+#if cfg_TABELA_ESTATICA
+/*
+ * Tabela estatica de tarefas: funcao, nome, tamanho da pilha, prioridade.
+ * As pilhas, a tabela e o vetor de prioridades sao gerados em tempo de compilacao.
+ */
+#define TABELA_DE_TAREFAS(X)										\
+	X(tarefa_1,      "Tarefa 1",      TAM_PILHA_1,      2)			\
+	X(tarefa_2,      "Tarefa 2",      TAM_PILHA_2,      1)			\
+	X(tarefa_ociosa, "Tarefa ociosa", TAM_PILHA_OCIOSA, 0)
+
+DEFINE_TABELA_DE_TAREFAS(TABELA_DE_TAREFAS)
+#else
 /*
  * Declaracao das pilhas das tarefas
  */
@@ -68,7 +99,16 @@ uint32_t PILHA_TAREFA_6[TAM_PILHA_6];
 uint32_t PILHA_TAREFA_7[TAM_PILHA_7];
 uint32_t PILHA_TAREFA_8[TAM_PILHA_8];
 uint32_t PILHA_TAREFA_9[TAM_PILHA_9];
+#if EXEMPLO_MUTEX_CONDICAO
+uint32_t PILHA_TAREFA_10[TAM_PILHA_10];
+uint32_t PILHA_TAREFA_11[TAM_PILHA_11];
+#endif
+#if MEDE_SINALIZACAO
+uint32_t PILHA_TAREFA_12[TAM_PILHA_12];
+uint32_t PILHA_TAREFA_13[TAM_PILHA_13];
+#endif
 uint32_t PILHA_TAREFA_OCIOSA[TAM_PILHA_OCIOSA];
+#endif
 
 /*
  * Funcao principal de entrada do sistema
@@ -80,15 +120,30 @@ int main(void)
 	system_init();
 #endif
 	
+#if cfg_TABELA_ESTATICA
+	/* Criacao das tarefas da tabela estatica, incluindo a tarefa ociosa */
+	IniciaTarefasEstaticas();
+#else
 	/* Criacao das tarefas */
 	/* Parametros: ponteiro, nome, ponteiro da pilha, tamanho da pilha, prioridade da tarefa */
     
+#if MEDE_SINALIZACAO
+	CriaTarefa(tarefa_12, "Tarefa 12", PILHA_TAREFA_12, TAM_PILHA_12, PRIORIDADE_MEDIDA);
+	
+	CriaTarefa(tarefa_13, "Tarefa 13", PILHA_TAREFA_13, TAM_PILHA_13, PRIORIDADE_MEDIDA - 1);
+#elif EXEMPLO_MUTEX_CONDICAO
+	CriaTarefa(tarefa_10, "Tarefa 10", PILHA_TAREFA_10, TAM_PILHA_10, 2);
+	
+	CriaTarefa(tarefa_11, "Tarefa 11", PILHA_TAREFA_11, TAM_PILHA_11, 1);
+#else
 	CriaTarefa(tarefa_1, "Tarefa 1", PILHA_TAREFA_1, TAM_PILHA_1, 2);
 	
 	CriaTarefa(tarefa_2, "Tarefa 2", PILHA_TAREFA_2, TAM_PILHA_2, 1);
+#endif
 	
 	/* Cria tarefa ociosa do sistema */
 	CriaTarefa(tarefa_ociosa,"Tarefa ociosa", PILHA_TAREFA_OCIOSA, TAM_PILHA_OCIOSA, 0);
+#endif
 	
 	/* Configura marca de tempo */
 	ConfiguraMarcaTempo();   
@@ -156,7 +211,7 @@ void tarefa_4(void)
 
 /* Tarefas de exemplo que usam funcoes de semaforo */
 
-semaforo_t SemaforoTeste = {0,0}; /* declaracao e inicializacao de um semaforo */
+semaforo_t SemaforoTeste = SEMAFORO_INICIAL(0, 0); /* declaracao e inicializacao de um semaforo */
 
 void tarefa_5(void)
 {
@@ -197,8 +252,8 @@ void tarefa_6(void)
 #define TAM_BUFFER 10
 uint8_t buffer[TAM_BUFFER]; /* declaracao de um buffer (vetor) ou fila circular */
 
-semaforo_t SemaforoCheio = {0,0}; /* declaracao e inicializacao de um semaforo */
-semaforo_t SemaforoVazio = {TAM_BUFFER,0}; /* declaracao e inicializacao de um semaforo */
+semaforo_t SemaforoCheio = SEMAFORO_INICIAL(0, TAM_BUFFER); /* semaforo com contador limitado ao tamanho do buffer */
+semaforo_t SemaforoVazio = SEMAFORO_INICIAL(TAM_BUFFER, TAM_BUFFER); /* semaforo com contador limitado ao tamanho do buffer */
 
 void tarefa_7(void)
 {
@@ -227,21 +282,7 @@ void tarefa_8(void)
 		
 	for(;;)
 	{
-		volatile uint8_t contador;
-		
-		do{
-			REG_ATOMICA_INICIO();			
-				contador = SemaforoCheio.contador;			
-			REG_ATOMICA_FIM();
-			
-			if (contador == 0)
-			{
-				TarefaEspera(100);
-			}
-				
-		} while (!contador);
-		
-		SemaforoAguarda(&SemaforoCheio);
+		SemaforoAguarda(&SemaforoCheio);	/* bloqueia ate haver dado, sem consultar o contador */
 		
 		valor = buffer[f];
 		f = (f+1) % TAM_BUFFER;		
@@ -263,3 +304,106 @@ void tarefa_9(void)
     	termo2 = proximo_termo;
 	}
 }
+
+/* solucao com buffer compartilhado usando mutex e variaveis de condicao:
+   a tarefa espera a condicao (buffer com dado ou com espaco) sem consulta
+   periodica e continua com o mutex obtido */
+
+uint8_t buffer_cond[TAM_BUFFER];
+uint8_t quantidade_cond = 0;
+
+mutex_t MutexBuffer = {0};
+condicao_t CondicaoComDado = {0};
+condicao_t CondicaoComEspaco = {0};
+
+void tarefa_10(void)
+{
+	uint8_t a = 1;
+	uint8_t i = 0;
+	
+	for(;;)
+	{
+		MutexTrava(&MutexBuffer);
+		while(quantidade_cond == TAM_BUFFER)
+		{
+			CondicaoAguarda(&CondicaoComEspaco, &MutexBuffer);
+		}
+		
+		buffer_cond[i] = a++;
+		i = (i+1)%TAM_BUFFER;
+		quantidade_cond++;
+		
+		CondicaoSinaliza(&CondicaoComDado);
+		MutexDestrava(&MutexBuffer);
+		
+		TarefaEspera(10);
+	}
+}
+
+void tarefa_11(void)
+{
+	uint8_t f = 0;
+	volatile uint8_t valor;
+	
+	for(;;)
+	{
+		MutexTrava(&MutexBuffer);
+		while(quantidade_cond == 0)
+		{
+			CondicaoAguarda(&CondicaoComDado, &MutexBuffer);
+		}
+		
+		valor = buffer_cond[f];
+		f = (f+1) % TAM_BUFFER;
+		quantidade_cond--;
+		
+		CondicaoSinaliza(&CondicaoComEspaco);
+		MutexDestrava(&MutexBuffer);
+	}
+}
+
+/* Medicao da sinalizacao: a tarefa_13 sinaliza a tarefa_12, de maior
+   prioridade e ja bloqueada, e a tarefa_12 mede os ciclos de clock ate voltar
+   a executar, incluindo a troca de contexto. Os resultados ficam nas variaveis
+   abaixo, para leitura com o depurador */
+
+semaforo_t SemaforoMedicao = SEMAFORO_INICIAL(0, 0);
+volatile uint32_t inicio_sinalizacao;
+volatile uint32_t ciclos_semaforo, ciclos_semaforo_max = 0;
+volatile uint32_t ciclos_notificacao, ciclos_notificacao_max = 0;
+
+void tarefa_12(void)
+{
+	for(;;)
+	{
+		SemaforoAguarda(&SemaforoMedicao);
+		ciclos_semaforo = CICLOS_DECORRIDOS(inicio_sinalizacao, LE_CONTADOR_CICLOS());
+		if(ciclos_semaforo > ciclos_semaforo_max)
+		{
+			ciclos_semaforo_max = ciclos_semaforo;
+		}
+		
+		(void)NotificacaoRecebe(1);
+		ciclos_notificacao = CICLOS_DECORRIDOS(inicio_sinalizacao, LE_CONTADOR_CICLOS());
+		if(ciclos_notificacao > ciclos_notificacao_max)
+		{
+			ciclos_notificacao_max = ciclos_notificacao;
+		}
+	}
+}
+
+void tarefa_13(void)
+{
+	uint8_t id_medida = Prioridades[PRIORIDADE_MEDIDA];
+	
+	for(;;)
+	{
+		TarefaEspera(1);		/* a tarefa_12 ja esta bloqueada */
+		inicio_sinalizacao = LE_CONTADOR_CICLOS();
+		SemaforoLibera(&SemaforoMedicao);
+		
+		TarefaEspera(1);
+		inicio_sinalizacao = LE_CONTADOR_CICLOS();
+		TarefaNotifica(id_medida, 0, NOTIFICA_DA);
+	}
+}
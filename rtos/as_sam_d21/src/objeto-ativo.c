@@ -0,0 +1,397 @@
+/*
+ * objeto-ativo.c
+ *
+ * Objetos ativos, pools de eventos e publicacao/assinatura sobre o sistema
+ * multitarefas.
+ */
+
+#include <asf.h>
+#include "rtos.h"
+#include "objeto-ativo.h"
+
+_Static_assert(cfg_AO_NUM_OBJETOS <= 32, "cfg_AO_NUM_OBJETOS maior que o numero de bits dos assinantes");
+
+/**
+* \struct pool_eventos_t
+* Blocos livres de um pool, encadeados por um ponteiro depois do cabecalho
+* evento_t, que continua indicando zero referencias enquanto o bloco esta livre
+*/
+
+typedef struct
+{
+	void		*livres;
+	uint16_t	tamanho_bloco;
+	uint16_t	numero_livres;
+	uint16_t	minimo_livres;		/* menor numero de blocos livres ja observado */
+} pool_eventos_t;
+
+/* ponteiro para o proximo bloco livre, alinhado depois do cabecalho */
+#define OFFSET_PROXIMO_LIVRE	((sizeof(evento_t) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+#define PROXIMO_LIVRE(bloco)	(*(void **)((uint8_t *)(bloco) + OFFSET_PROXIMO_LIVRE))
+
+static pool_eventos_t	pools[cfg_AO_NUM_POOLS];
+static uint8_t			numero_pools = 0;
+
+static objeto_ativo_t	*objetos[cfg_AO_NUM_OBJETOS];
+static uint8_t			numero_objetos = 0;
+
+/* objetos que assinaram cada sinal, um bit por objeto */
+static uint32_t			assinantes[cfg_AO_NUM_SINAIS];
+
+/* grupo de cada tarefa, pelo numero da tarefa (a prioridade pode mudar) */
+static grupo_ao_t		*grupo_da_tarefa[NUMERO_DE_TAREFAS+1];
+
+static const evento_t	evento_inicio = EVENTO_ESTATICO(AO_SINAL_INICIO);
+
+/* Cria um pool de eventos. Os pools devem ser criados em ordem crescente de
+   tamanho de bloco; a memoria deve estar alinhada a 4 bytes e ter
+   numero_blocos blocos com o tamanho arredondado para multiplo de 4, de no
+   minimo 8 bytes (cabecalho e ponteiro do proximo bloco livre) */
+void EventoPoolInicia(void *memoria, uint16_t tamanho_bloco, uint16_t numero_blocos)
+{
+	pool_eventos_t *pool;
+	uint8_t *bloco = (uint8_t *)memoria;
+	uint16_t i;
+
+	if(numero_pools == cfg_AO_NUM_POOLS || numero_blocos == 0 ||
+	   (numero_pools > 0 && tamanho_bloco < pools[numero_pools - 1].tamanho_bloco))
+	{
+		return;
+	}
+
+	tamanho_bloco = (uint16_t)((tamanho_bloco + 3u) & ~3u);
+	if(tamanho_bloco < OFFSET_PROXIMO_LIVRE + sizeof(void *))
+	{
+		tamanho_bloco = OFFSET_PROXIMO_LIVRE + sizeof(void *);
+	}
+
+	pool = &pools[numero_pools];
+	pool->livres = NULL;
+	for(i = 0; i < numero_blocos; i++)
+	{
+		((evento_t *)bloco)->pool = numero_pools;
+		((evento_t *)bloco)->referencias = 0;
+		PROXIMO_LIVRE(bloco) = pool->livres;
+		pool->livres = bloco;
+		bloco += tamanho_bloco;
+	}
+	pool->tamanho_bloco = tamanho_bloco;
+	pool->numero_livres = numero_blocos;
+	pool->minimo_livres = numero_blocos;
+
+	REG_ATOMICA_INICIO();
+	numero_pools++;
+	REG_ATOMICA_FIM();
+}
+
+/* Aloca um evento do menor pool com blocos de pelo menos tamanho bytes.
+   Retorna NULL se esse pool estiver vazio */
+evento_t *EventoNovo(uint16_t tamanho, uint8_t sinal)
+{
+	evento_t *evento = NULL;
+	uint8_t p;
+
+	for(p = 0; p < numero_pools && pools[p].tamanho_bloco < tamanho; p++)
+	{
+	}
+	if(p == numero_pools)
+	{
+		return NULL;
+	}
+
+	REG_ATOMICA_INICIO();
+	if(pools[p].livres != NULL)
+	{
+		evento = (evento_t *)pools[p].livres;
+		pools[p].livres = PROXIMO_LIVRE(evento);
+		pools[p].numero_livres--;
+		if(pools[p].numero_livres < pools[p].minimo_livres)
+		{
+			pools[p].minimo_livres = pools[p].numero_livres;
+		}
+	}
+	REG_ATOMICA_FIM();
+
+	if(evento != NULL)
+	{
+		evento->sinal = sinal;
+		evento->pool = p;
+		evento->referencias = 0;
+	}
+	return evento;
+}
+
+/* deve ser chamada em regiao critica */
+static void EventoDevolve(evento_t *e)
+{
+	pool_eventos_t *pool = &pools[e->pool];
+
+	PROXIMO_LIVRE(e) = pool->livres;
+	pool->livres = e;
+	pool->numero_livres++;
+}
+
+/* Retira uma referencia ao evento e o devolve ao pool quando nao houver mais
+   referencias. Um evento sem referencias ja voltou ao pool (ou nunca foi
+   postado, e e devolvido por ObjetoAtivoPosta/EventoPublica): liberar de
+   novo corromperia a lista de blocos livres, por isso e ignorado */
+void EventoLibera(const evento_t *evento)
+{
+	evento_t *e = (evento_t *)evento;
+
+	if(e->pool == AO_EVENTO_ESTATICO)
+	{
+		return;
+	}
+
+	REG_ATOMICA_INICIO();
+	if(e->referencias == 0)
+	{
+		Assert(0);		/* liberacao dupla */
+	}
+	else if(--e->referencias == 0)
+	{
+		EventoDevolve(e);
+	}
+	REG_ATOMICA_FIM();
+}
+
+/* Devolve ao pool um evento que nao chegou a nenhuma fila */
+static void EventoDescarta(const evento_t *evento)
+{
+	evento_t *e = (evento_t *)evento;
+
+	if(e->pool == AO_EVENTO_ESTATICO)
+	{
+		return;
+	}
+
+	REG_ATOMICA_INICIO();
+	if(e->referencias == 0)
+	{
+		EventoDevolve(e);
+	}
+	REG_ATOMICA_FIM();
+}
+
+uint16_t EventoPoolMinimoLivres(uint8_t pool)
+{
+	return (pool < numero_pools) ? pools[pool].minimo_livres : 0;
+}
+
+/* Tarefa de um grupo: despacha um evento por vez, do objeto de maior
+   prioridade com eventos na fila, ate o fim */
+static void TarefaDoGrupo(void)
+{
+	grupo_ao_t *grupo = grupo_da_tarefa[tarefa_atual];
+
+	for(;;)
+	{
+		objeto_ativo_t *ao;
+		const evento_t *evento = NULL;
+
+		SemaforoAguarda(&grupo->pendentes);
+
+		REG_ATOMICA_INICIO();
+		for(ao = grupo->objetos; ao != NULL; ao = ao->proximo)
+		{
+			if(ao->quantidade > 0)
+			{
+				evento = ao->fila[ao->inicio];
+				ao->inicio = (uint8_t)((ao->inicio + 1) % ao->tamanho);
+				ao->quantidade--;
+				break;
+			}
+		}
+		REG_ATOMICA_FIM();
+
+		if(evento != NULL)
+		{
+			ao->despacho(ao, evento);
+			EventoLibera(evento);
+		}
+	}
+}
+
+/* Cria a tarefa do kernel que executa os objetos ativos de uma prioridade. O
+   grupo fica associado ao numero da tarefa antes que ela execute */
+void GrupoObjetosAtivosInicia(grupo_ao_t *grupo, const char *nome, stackptr_t pilha,
+							  uint16_t tamanho, prioridade_t prioridade)
+{
+	uint8_t anterior, id;
+
+	grupo->pendentes.contador = 0;
+	grupo->pendentes.tarefasEsperando = 0;
+	grupo->pendentes.maximo = 0;
+	grupo->objetos = NULL;
+
+	EscalonadorBloqueia();
+	anterior = Prioridades[prioridade];
+	CriaTarefa(TarefaDoGrupo, nome, pilha, tamanho, prioridade);
+	id = Prioridades[prioridade];
+	if(id != anterior)
+	{
+		grupo_da_tarefa[id] = grupo;	/* tarefa criada */
+	}
+	EscalonadorLibera();
+}
+
+/* Acrescenta um objeto ativo ao grupo, com prioridade menor que a dos objetos
+   ja iniciados nele, e posta o evento AO_SINAL_INICIO */
+enum status_code ObjetoAtivoInicia(objeto_ativo_t *ao, grupo_ao_t *grupo, ao_despacho_t despacho,
+								   const evento_t **fila, uint8_t tamanho_fila)
+{
+	objeto_ativo_t **ultimo;
+
+	if(numero_objetos == cfg_AO_NUM_OBJETOS || tamanho_fila == 0)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+
+	ultimo = &grupo->objetos;
+	while(*ultimo != NULL)
+	{
+		ultimo = &(*ultimo)->proximo;
+	}
+
+	ao->despacho = despacho;
+	ao->grupo = grupo;
+	ao->proximo = NULL;
+	ao->fila = fila;
+	ao->tamanho = tamanho_fila;
+	ao->inicio = 0;
+	ao->quantidade = 0;
+	ao->max_quantidade = 0;
+
+	REG_ATOMICA_INICIO();
+	ao->id = numero_objetos;
+	objetos[numero_objetos++] = ao;
+	*ultimo = ao;
+	REG_ATOMICA_FIM();
+
+	return ObjetoAtivoPosta(ao, &evento_inicio);
+}
+
+/* Coloca o evento na fila do objeto, sem bloquear. Com a fila cheia retorna
+   STATUS_ERR_OVERFLOW e o evento sem outras referencias volta ao pool. Em uma
+   interrupcao o grupo e acordado com SemaforoLiberaISR() e a troca de contexto
+   fica para FIM_DE_INTERRUPCAO() */
+enum status_code ObjetoAtivoPosta(objeto_ativo_t *ao, const evento_t *evento)
+{
+	enum status_code resultado = STATUS_OK;
+
+	REG_ATOMICA_INICIO();
+
+	if(ao->quantidade == ao->tamanho)
+	{
+		resultado = STATUS_ERR_OVERFLOW;
+	}
+	else
+	{
+		if(evento->pool != AO_EVENTO_ESTATICO)
+		{
+			((evento_t *)evento)->referencias++;
+		}
+		ao->fila[(ao->inicio + ao->quantidade) % ao->tamanho] = evento;
+		ao->quantidade++;
+		if(ao->quantidade > ao->max_quantidade)
+		{
+			ao->max_quantidade = ao->quantidade;
+		}
+		if(EM_INTERRUPCAO())
+		{
+			(void)SemaforoLiberaISR(&ao->grupo->pendentes);
+		}
+		else
+		{
+			(void)SemaforoLibera(&ao->grupo->pendentes);
+		}
+	}
+
+	REG_ATOMICA_FIM();
+
+	if(resultado != STATUS_OK)
+	{
+		EventoDescarta(evento);
+	}
+	return resultado;
+}
+
+enum status_code EventoAssina(objeto_ativo_t *ao, uint8_t sinal)
+{
+	if(sinal >= cfg_AO_NUM_SINAIS)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+
+	REG_ATOMICA_INICIO();
+	assinantes[sinal] |= (1UL << ao->id);
+	REG_ATOMICA_FIM();
+
+	return STATUS_OK;
+}
+
+enum status_code EventoCancelaAssinatura(objeto_ativo_t *ao, uint8_t sinal)
+{
+	if(sinal >= cfg_AO_NUM_SINAIS)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+
+	REG_ATOMICA_INICIO();
+	assinantes[sinal] &= ~(1UL << ao->id);
+	REG_ATOMICA_FIM();
+
+	return STATUS_OK;
+}
+
+/* Posta o evento para todos os objetos que assinaram o seu sinal. O
+   escalonador fica bloqueado durante a entrega, de modo que nenhum assinante
+   despacha o evento antes que todos o tenham recebido; a referencia extra
+   impede que o evento volte ao pool durante a entrega. Em uma interrupcao o
+   escalonador nao e bloqueado (o bloqueio pertence a tarefa interrompida):
+   nenhuma tarefa executa antes do fim da rotina, que termina com
+   FIM_DE_INTERRUPCAO() */
+enum status_code EventoPublica(const evento_t *evento)
+{
+	enum status_code resultado = STATUS_OK;
+	uint32_t destinos;
+	uint8_t id;
+	uint8_t em_interrupcao = EM_INTERRUPCAO();
+
+	if(evento->sinal >= cfg_AO_NUM_SINAIS)
+	{
+		EventoDescarta(evento);
+		return STATUS_ERR_INVALID_ARG;
+	}
+
+	if(!em_interrupcao)
+	{
+		EscalonadorBloqueia();
+	}
+
+	REG_ATOMICA_INICIO();
+	if(evento->pool != AO_EVENTO_ESTATICO)
+	{
+		((evento_t *)evento)->referencias++;
+	}
+	destinos = assinantes[evento->sinal];
+	REG_ATOMICA_FIM();
+
+	for(id = 0; destinos != 0; id++, destinos >>= 1)
+	{
+		if((destinos & 1u) && ObjetoAtivoPosta(objetos[id], evento) != STATUS_OK)
+		{
+			resultado = STATUS_ERR_OVERFLOW;
+		}
+	}
+
+	if(!em_interrupcao)
+	{
+		EscalonadorLibera();
+	}
+
+	EventoLibera(evento);
+
+	return resultado;
+}
@@ -0,0 +1,136 @@
+/*
+ * objeto-ativo.h
+ *
+ * Objetos ativos: maquinas de estados alimentadas por eventos em vez de
+ * consulta periodica (como ReceptorFSM e struct StateMachine dos exercicios).
+ *
+ * - Cada objeto ativo tem a sua fila de eventos e uma funcao de despacho,
+ *   executada ate o fim (run-to-completion) para cada evento.
+ * - Os objetos ativos sao agrupados por prioridade: cada grupo e uma unica
+ *   tarefa do kernel, com uma unica pilha, que despacha os eventos dos seus
+ *   objetos, com prioridade para o objeto iniciado primeiro no grupo.
+ * - Eventos com dados sao alocados de pools de blocos de tamanho fixo e tem
+ *   contador de referencias: o evento volta ao pool depois de despachado por
+ *   todos os destinatarios. Eventos sem dados podem ser constantes.
+ * - Entrega direta (ObjetoAtivoPosta) ou publicacao para os objetos que
+ *   assinaram o sinal (EventoAssina/EventoPublica). Tarefas, interrupcoes e
+ *   os proprios objetos ativos podem criar, postar e publicar eventos; uma
+ *   rotina de interrupcao que posta ou publica termina com
+ *   FIM_DE_INTERRUPCAO().
+ *
+ * Uso:
+ *
+ *   typedef struct { objeto_ativo_t super; uint8_t estado; ... } receptor_t;
+ *   typedef struct { evento_t super; uint8_t byte; } evento_byte_t;
+ *
+ *   static void ReceptorDespacha(objeto_ativo_t *ao, const evento_t *e) { ... }
+ *
+ *   EventoPoolInicia(pool_pequeno, sizeof(evento_byte_t), 16);
+ *   GrupoObjetosAtivosInicia(&grupo, "Receptores", PILHA_RECEPTORES, TAM_PILHA, 3);
+ *   ObjetoAtivoInicia(&receptor.super, &grupo, ReceptorDespacha, fila_receptor, 8);
+ *   EventoAssina(&receptor.super, SINAL_BYTE);
+ *
+ *   evento_byte_t *e = (evento_byte_t *)EventoNovo(sizeof(evento_byte_t), SINAL_BYTE);
+ *   e->byte = dado;
+ *   EventoPublica(&e->super);
+ */
+
+#ifndef OBJETO_ATIVO_H_
+#define OBJETO_ATIVO_H_
+
+#include "rtos.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* numero de pools de eventos, de sinais publicaveis e de objetos ativos
+   (no maximo 32, um bit por objeto na lista de assinantes) */
+#ifndef cfg_AO_NUM_POOLS
+#define cfg_AO_NUM_POOLS			3
+#endif
+
+#ifndef cfg_AO_NUM_SINAIS
+#define cfg_AO_NUM_SINAIS			16
+#endif
+
+#ifndef cfg_AO_NUM_OBJETOS
+#define cfg_AO_NUM_OBJETOS			8
+#endif
+
+/* sinais reservados */
+#define AO_SINAL_INICIO				0		/* primeiro evento despachado a cada objeto */
+#define AO_SINAL_USUARIO			1		/* primeiro sinal da aplicacao */
+
+/* evento sem pool (constante ou estatico), nunca liberado */
+#define AO_EVENTO_ESTATICO			0xFF
+
+/**
+* \struct evento_t
+* Cabecalho dos eventos; eventos com dados o incluem como primeiro campo
+*/
+
+typedef struct
+{
+	uint8_t		sinal;
+	uint8_t		pool;			/* pool de origem ou AO_EVENTO_ESTATICO */
+	uint8_t		referencias;	/* filas em que o evento ainda esta */
+} evento_t;
+
+/* evento constante, sem dados: const evento_t ev = EVENTO_ESTATICO(SINAL_X); */
+#define EVENTO_ESTATICO(sinal)		{ (sinal), AO_EVENTO_ESTATICO, 0 }
+
+typedef struct objeto_ativo objeto_ativo_t;
+typedef void (*ao_despacho_t)(objeto_ativo_t *ao, const evento_t *evento);
+
+/**
+* \struct grupo_ao_t
+* Tarefa do kernel que despacha os eventos dos objetos ativos de uma prioridade
+*/
+
+typedef struct
+{
+	semaforo_t		pendentes;		/* eventos nas filas dos objetos do grupo */
+	objeto_ativo_t	*objetos;		/* em ordem de prioridade dentro do grupo */
+} grupo_ao_t;
+
+/**
+* \struct objeto_ativo
+* Estrutura de controle de um objeto ativo; a maquina de estados da aplicacao
+* a inclui como primeiro campo
+*/
+
+struct objeto_ativo
+{
+	ao_despacho_t	despacho;
+	grupo_ao_t		*grupo;
+	objeto_ativo_t	*proximo;		/* proximo objeto do grupo */
+	const evento_t	**fila;			/* memoria da fila, fornecida pela aplicacao */
+	uint8_t			tamanho;
+	uint8_t			inicio;
+	uint8_t			quantidade;
+	uint8_t			id;				/* bit na lista de assinantes */
+	uint8_t			max_quantidade;	/* maior ocupacao da fila */
+};
+
+void EventoPoolInicia(void *memoria, uint16_t tamanho_bloco, uint16_t numero_blocos);
+evento_t *EventoNovo(uint16_t tamanho, uint8_t sinal);
+void EventoLibera(const evento_t *evento);
+uint16_t EventoPoolMinimoLivres(uint8_t pool);
+
+void GrupoObjetosAtivosInicia(grupo_ao_t *grupo, const char *nome, stackptr_t pilha,
+							  uint16_t tamanho, prioridade_t prioridade);
+enum status_code ObjetoAtivoInicia(objeto_ativo_t *ao, grupo_ao_t *grupo, ao_despacho_t despacho,
+								   const evento_t **fila, uint8_t tamanho_fila);
+
+enum status_code ObjetoAtivoPosta(objeto_ativo_t *ao, const evento_t *evento);
+
+enum status_code EventoAssina(objeto_ativo_t *ao, uint8_t sinal);
+enum status_code EventoCancelaAssinatura(objeto_ativo_t *ao, uint8_t sinal);
+enum status_code EventoPublica(const evento_t *evento);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OBJETO_ATIVO_H_ */
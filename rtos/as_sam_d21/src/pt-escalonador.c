@@ -0,0 +1,419 @@
+/*
+ * pt-escalonador.c
+ *
+ * Escalonador de protothreads executado por uma tarefa do sistema multitarefas.
+ */
+
+#include <asf.h>
+#include "rtos.h"
+#include "pt-escalonador.h"
+
+/* fila de prontas (em ordem de chegada), protegida por regiao critica pois
+   recebe protothreads sinalizadas por tarefas e interrupcoes */
+static protothread_t *prontas = NULL;
+static protothread_t *ultima_pronta = NULL;
+
+/* listas usadas somente pela tarefa do escalonador */
+static protothread_t *atrasadas = NULL;		/* ordenada pela marca de despertar */
+static protothread_t *sondadas = NULL;		/* PT_WAIT_UNTIL: reavaliadas a cada marca */
+static protothread_t *aguardam_semaforo = NULL;	/* PT_ESPERA_SEMAFORO, em ordem de chegada */
+
+/* tarefa do escalonador bloqueada sem protothreads prontas */
+static semaforo_t sinal = SEMAFORO_INICIAL(0, 0);
+static volatile uint8_t sinal_pendente = 0;
+
+static uint16_t ativas = 0;
+
+/* executa a chamada em regiao critica, tambem em rotinas de interrupcao, que
+   usam REG_ATOMICA_ISR_* (sem o contador de aninhamento das tarefas) */
+#define EM_REGIAO_CRITICA(chamada)											\
+	do {																	\
+		if(EM_INTERRUPCAO())												\
+		{																	\
+			REG_ATOMICA_ISR_INICIO(estado);									\
+			chamada;														\
+			REG_ATOMICA_ISR_FIM(estado);									\
+		}																	\
+		else																\
+		{																	\
+			REG_ATOMICA_INICIO();											\
+			chamada;														\
+			REG_ATOMICA_FIM();												\
+		}																	\
+	} while(0)
+
+/* deve ser chamada em regiao critica; em uma interrupcao, a tarefa do
+   escalonador so e acordada em FIM_DE_INTERRUPCAO() */
+static void InserePronta(protothread_t *pt)
+{
+	pt->estado = PT_PRONTA;
+	pt->proximo = NULL;
+	if(prontas == NULL)
+	{
+		prontas = pt;
+	}
+	else
+	{
+		ultima_pronta->proximo = pt;
+	}
+	ultima_pronta = pt;
+
+	if(!sinal_pendente)
+	{
+		sinal_pendente = 1;
+		if(EM_INTERRUPCAO())
+		{
+			SemaforoLiberaISR(&sinal);
+		}
+		else
+		{
+			SemaforoLibera(&sinal);
+		}
+	}
+}
+
+static protothread_t *RetiraPronta(void)
+{
+	protothread_t *pt;
+
+	REG_ATOMICA_INICIO();
+	pt = prontas;
+	if(pt != NULL)
+	{
+		prontas = pt->proximo;
+		pt->estado = PT_EXECUTANDO;
+	}
+	REG_ATOMICA_FIM();
+
+	return pt;
+}
+
+/* despertar vencido (tick_t retorna a zero): atrasos de ate metade do tick_t */
+static uint8_t Venceu(tick_t despertar, tick_t agora)
+{
+	return (tick_t)(agora - despertar) < (tick_t)(MARCAS_INDEFINIDAS / 2);
+}
+
+/* prepara a protothread e a coloca na fila de prontas */
+void PtInicia(protothread_t *pt, pt_funcao_t funcao)
+{
+	PT_INIT(pt);
+	pt->funcao = funcao;
+	pt->sinalizacao = 0;
+
+	REG_ATOMICA_INICIO();
+	ativas++;
+	InserePronta(pt);
+	REG_ATOMICA_FIM();
+}
+
+uint16_t PtAtivas(void)
+{
+	return ativas;
+}
+
+/* bloqueia a protothread em execucao no evento, a menos que ele tenha sido
+   sinalizado depois da avaliacao da condicao (PT_ESPERA_EVENTO) */
+void PtAguardaEvento(protothread_t *pt, pt_evento_t *evento)
+{
+	REG_ATOMICA_INICIO();
+
+	if(evento->sinalizacoes != pt->sinalizacao)
+	{
+		InserePronta(pt);
+	}
+	else
+	{
+		pt->estado = PT_BLOQUEADA;
+		pt->proximo = NULL;
+		if(evento->primeira == NULL)
+		{
+			evento->primeira = pt;
+		}
+		else
+		{
+			evento->ultima->proximo = pt;
+		}
+		evento->ultima = pt;
+	}
+
+	REG_ATOMICA_FIM();
+}
+
+/* deve ser chamada em regiao critica */
+static void EventoSinaliza(pt_evento_t *evento, uint8_t todas)
+{
+	protothread_t *pt;
+
+	evento->sinalizacoes++;
+	pt = evento->primeira;
+	while(pt != NULL)
+	{
+		protothread_t *proxima = pt->proximo;
+
+		evento->primeira = proxima;
+		InserePronta(pt);
+		pt = todas ? proxima : NULL;
+	}
+}
+
+/* acorda todas as protothreads esperando o evento */
+void PtEventoSinaliza(pt_evento_t *evento)
+{
+	EM_REGIAO_CRITICA(EventoSinaliza(evento, 1));
+}
+
+/* acorda somente a protothread mais antiga esperando o evento */
+void PtEventoSinalizaUma(pt_evento_t *evento)
+{
+	EM_REGIAO_CRITICA(EventoSinaliza(evento, 0));
+}
+
+uint8_t PtSemaforoTentaAguardar(pt_semaforo_t *sem)
+{
+	uint8_t obtido = 0;
+
+	REG_ATOMICA_INICIO();
+	if(sem->contador > 0)
+	{
+		sem->contador--;
+		obtido = 1;
+	}
+	REG_ATOMICA_FIM();
+
+	return obtido;
+}
+
+/* deve ser chamada em regiao critica */
+static void SemaforoPtLibera(pt_semaforo_t *sem)
+{
+	sem->contador++;
+	EventoSinaliza(&sem->evento, 0);
+}
+
+void PtSemaforoLibera(pt_semaforo_t *sem)
+{
+	EM_REGIAO_CRITICA(SemaforoPtLibera(sem));
+}
+
+/* bloqueia a protothread em execucao por marcas de tempo (lista ordenada) */
+void PtAtrasa(protothread_t *pt, tick_t marcas)
+{
+	protothread_t **pp = &atrasadas;
+	tick_t agora = MarcasDeTempo();
+
+	if(marcas == 0)
+	{
+		REG_ATOMICA_INICIO();
+		InserePronta(pt);
+		REG_ATOMICA_FIM();
+		return;
+	}
+
+	pt->estado = PT_BLOQUEADA;
+	pt->despertar = (tick_t)(agora + marcas);
+
+	while(*pp != NULL && (Venceu((*pp)->despertar, agora) ||
+						  (tick_t)((*pp)->despertar - agora) <= marcas))
+	{
+		pp = &(*pp)->proximo;
+	}
+	pt->proximo = *pp;
+	*pp = pt;
+}
+
+/* bloqueia a protothread em execucao ate a tarefa do escalonador obter uma
+   unidade do semaforo do kernel por ela (PT_ESPERA_SEMAFORO) */
+void PtAguardaSemaforo(protothread_t *pt, semaforo_t *sem)
+{
+	protothread_t **pp = &aguardam_semaforo;
+
+	pt->estado = PT_BLOQUEADA;
+	pt->semaforo = sem;
+	pt->proximo = NULL;
+	while(*pp != NULL)
+	{
+		pp = &(*pp)->proximo;
+	}
+	*pp = pt;
+}
+
+/* entrega a unidade obtida do semaforo do kernel a protothread mais antiga
+   que o espera */
+static void EntregaSemaforo(semaforo_t *sem)
+{
+	protothread_t **pp = &aguardam_semaforo;
+
+	while(*pp != NULL && (*pp)->semaforo != sem)
+	{
+		pp = &(*pp)->proximo;
+	}
+
+	if(*pp != NULL)
+	{
+		protothread_t *pt = *pp;
+
+		*pp = pt->proximo;
+		REG_ATOMICA_INICIO();
+		InserePronta(pt);
+		REG_ATOMICA_FIM();
+	}
+	else
+	{
+		(void)SemaforoLibera(sem);
+	}
+}
+
+/* monta o vetor de semaforos da espera da tarefa do escalonador: o sinal das
+   prontas e os semaforos do kernel esperados, sem repeticao, e o limite de
+   tempo (0: sem limite). Os semaforos que nao cabem no vetor sao verificados
+   aqui, uma vez por marca; retorna 0 se um deles foi obtido */
+static uint8_t PreparaEspera(semaforo_t **espera, tick_t *marcas)
+{
+	protothread_t *pt = aguardam_semaforo;
+	tick_t agora = MarcasDeTempo();
+	uint8_t numero = 1;
+	uint8_t i;
+
+	espera[0] = &sinal;
+	*marcas = 0;
+
+	while(pt != NULL)
+	{
+		semaforo_t *sem = pt->semaforo;
+
+		pt = pt->proximo;
+		for(i = 1; i < numero && espera[i] != sem; i++)
+		{
+		}
+
+		if(i < numero)
+		{
+			continue;
+		}
+		if(numero <= cfg_PT_SEMAFOROS_KERNEL)
+		{
+			espera[numero++] = sem;
+		}
+		else if(SemaforoTentaAguardar(sem) == STATUS_OK)
+		{
+			EntregaSemaforo(sem);
+			return 0;
+		}
+		else
+		{
+			*marcas = 1;
+		}
+	}
+
+	if(sondadas != NULL)
+	{
+		*marcas = 1;
+	}
+	else if(atrasadas != NULL && *marcas == 0)
+	{
+		*marcas = Venceu(atrasadas->despertar, agora) ? 1 : (tick_t)(atrasadas->despertar - agora);
+	}
+
+	return numero;
+}
+
+/* executa uma protothread retirada da fila de prontas */
+static void ExecutaProtothread(protothread_t *pt)
+{
+	char resultado = pt->funcao(pt);
+
+	switch(resultado)
+	{
+		case PT_YIELDED:
+			REG_ATOMICA_INICIO();
+			InserePronta(pt);
+			REG_ATOMICA_FIM();
+			break;
+
+		case PT_WAITING:
+			/* sem PtAguardaEvento()/PtAtrasa(): PT_WAIT_UNTIL comum */
+			if(pt->estado == PT_EXECUTANDO)
+			{
+				pt->estado = PT_SONDADA;
+				pt->proximo = sondadas;
+				sondadas = pt;
+			}
+			break;
+
+		default:	/* PT_EXITED, PT_ENDED */
+			pt->estado = PT_TERMINADA;
+			REG_ATOMICA_INICIO();
+			ativas--;
+			REG_ATOMICA_FIM();
+			break;
+	}
+}
+
+/* acorda as protothreads atrasadas vencidas e as sondadas, uma vez por marca */
+static void VerificaMarca(void)
+{
+	tick_t agora = MarcasDeTempo();
+	protothread_t *pt;
+
+	REG_ATOMICA_INICIO();
+
+	while(atrasadas != NULL && Venceu(atrasadas->despertar, agora))
+	{
+		pt = atrasadas;
+		atrasadas = pt->proximo;
+		InserePronta(pt);
+	}
+
+	pt = sondadas;
+	sondadas = NULL;
+	while(pt != NULL)
+	{
+		protothread_t *proxima = pt->proximo;
+
+		InserePronta(pt);
+		pt = proxima;
+	}
+
+	REG_ATOMICA_FIM();
+}
+
+/* corpo da tarefa do escalonador de protothreads, nunca retorna */
+void PtEscalonadorExecuta(void)
+{
+	static semaforo_t *espera[1 + cfg_PT_SEMAFOROS_KERNEL];
+	tick_t ultima_marca = MarcasDeTempo();
+
+	for(;;)
+	{
+		protothread_t *pt;
+		tick_t marcas;
+		uint8_t numero, indice;
+
+		while((pt = RetiraPronta()) != NULL)
+		{
+			ExecutaProtothread(pt);
+		}
+
+		if(MarcasDeTempo() != ultima_marca)
+		{
+			ultima_marca = MarcasDeTempo();
+			VerificaMarca();
+			continue;
+		}
+
+		numero = PreparaEspera(espera, &marcas);
+		if(numero != 0 &&
+		   SemaforoAguardaQualquer(espera, numero, marcas, &indice) == STATUS_OK)
+		{
+			if(indice == 0)
+			{
+				sinal_pendente = 0;
+			}
+			else
+			{
+				EntregaSemaforo(espera[indice]);
+			}
+		}
+	}
+}
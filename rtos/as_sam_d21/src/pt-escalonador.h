@@ -0,0 +1,152 @@
+/*
+ * pt-escalonador.h
+ *
+ * Escalonador de protothreads executado por uma tarefa do sistema multitarefas.
+ *
+ * As protothreads prontas ficam em uma fila, executada em ordem de chegada
+ * pela tarefa que chama PtEscalonadorExecuta(). Uma protothread bloqueada nao
+ * e chamada ate que o motivo do bloqueio termine:
+ *
+ *   PT_ESPERA_EVENTO(pt, &evento, condicao)   ate PtEventoSinaliza(&evento)
+ *                                             tornar a condicao verdadeira
+ *   PT_SEMAFORO_AGUARDA(pt, &sem)             pt_semaforo_t, liberado com
+ *                                             PtSemaforoLibera()
+ *   PT_ESPERA_MARCAS(pt, marcas)              marcas de tempo do sistema
+ *   PT_ESPERA_SEMAFORO(pt, &sem)              semaforo_t do kernel, liberado
+ *                                             por tarefas ou interrupcoes
+ *
+ * Eventos e semaforos podem ser sinalizados por tarefas, interrupcoes ou
+ * outras protothreads. Uma rotina de interrupcao que chama PtEventoSinaliza(),
+ * PtEventoSinalizaUma() ou PtSemaforoLibera() deve terminar com
+ * FIM_DE_INTERRUPCAO(), para que a tarefa do escalonador seja acordada.
+ *
+ * Sem protothreads prontas, a tarefa do escalonador bloqueia com
+ * SemaforoAguardaQualquer() no seu semaforo de sinalizacao e nos semaforos do
+ * kernel esperados com PT_ESPERA_SEMAFORO() (ate cfg_PT_SEMAFOROS_KERNEL
+ * semaforos distintos; os excedentes sao verificados a cada marca de tempo),
+ * com limite de tempo ate o proximo despertar de PT_ESPERA_MARCAS().
+ *
+ * PT_WAIT_UNTIL() continua funcionando, mas a condicao e avaliada uma vez por
+ * marca de tempo, pois o escalonador nao sabe quando ela muda.
+ *
+ * Uso:
+ *
+ *   static protothread_t receptor;
+ *
+ *   PT_THREAD(protothread_receptor(protothread_t *pt))
+ *   {
+ *       PT_BEGIN(pt);
+ *       for(;;) { PT_ESPERA_EVENTO(pt, &evento_rx, rx_len > 0); ... }
+ *       PT_END(pt);
+ *   }
+ *
+ *   void tarefa_protothreads(void)
+ *   {
+ *       PtInicia(&receptor, protothread_receptor);
+ *       PtEscalonadorExecuta();
+ *   }
+ */
+
+#ifndef PT_ESCALONADOR_H_
+#define PT_ESCALONADOR_H_
+
+#include "rtos.h"
+#include "pt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* semaforos do kernel distintos esperados pela tarefa do escalonador ao mesmo
+   tempo (PT_ESPERA_SEMAFORO) */
+#ifndef cfg_PT_SEMAFOROS_KERNEL
+#define cfg_PT_SEMAFOROS_KERNEL		4
+#endif
+
+typedef struct protothread protothread_t;
+typedef char (*pt_funcao_t)(protothread_t *pt);
+
+typedef enum {PT_PRONTA, PT_EXECUTANDO, PT_BLOQUEADA, PT_SONDADA, PT_TERMINADA} estado_pt_t;
+
+/**
+* \struct protothread
+* Estrutura de controle de uma protothread. O campo lc (continuacao local)
+* e o primeiro, de modo que as macros PT_* de pt.h recebem protothread_t*.
+*/
+
+struct protothread
+{
+	unsigned short	lc;
+	pt_funcao_t		funcao;
+	protothread_t	*proximo;		/* fila de prontas, de espera por evento, tempo ou semaforo */
+	estado_pt_t		estado;
+	uint8_t			sinalizacao;	/* contador do evento visto ao avaliar a condicao */
+	tick_t			despertar;		/* PT_ESPERA_MARCAS(): marca de tempo do despertar */
+	semaforo_t		*semaforo;		/* PT_ESPERA_SEMAFORO(): semaforo do kernel esperado */
+};
+
+/**
+* \struct pt_evento_t
+* Evento: lista de protothreads esperando e contador de sinalizacoes
+*/
+
+typedef struct
+{
+	protothread_t	*primeira;
+	protothread_t	*ultima;
+	uint8_t			sinalizacoes;
+} pt_evento_t;
+
+/**
+* \struct pt_semaforo_t
+* Semaforo contador para protothreads
+*/
+
+typedef struct
+{
+	uint16_t		contador;
+	pt_evento_t		evento;
+} pt_semaforo_t;
+
+void PtInicia(protothread_t *pt, pt_funcao_t funcao);
+void PtEscalonadorExecuta(void);
+uint16_t PtAtivas(void);
+
+void PtEventoSinaliza(pt_evento_t *evento);
+void PtEventoSinalizaUma(pt_evento_t *evento);
+
+uint8_t PtSemaforoTentaAguardar(pt_semaforo_t *sem);
+void PtSemaforoLibera(pt_semaforo_t *sem);
+
+/* usadas pelas macros abaixo */
+void PtAguardaEvento(protothread_t *pt, pt_evento_t *evento);
+void PtAtrasa(protothread_t *pt, tick_t marcas);
+void PtAguardaSemaforo(protothread_t *pt, semaforo_t *sem);
+
+/* espera a condicao, reavaliada somente quando o evento e sinalizado. O
+   contador de sinalizacoes e lido antes da condicao: uma sinalizacao entre a
+   avaliacao e o bloqueio coloca a protothread de volta na fila de prontas */
+#define PT_ESPERA_EVENTO(pt, evento, condicao)							\
+	do { (pt)->lc = __LINE__; case __LINE__:							\
+	(pt)->sinalizacao = (evento)->sinalizacoes;							\
+	if(!(condicao)) { PtAguardaEvento((pt), (evento)); return PT_WAITING; } } while(0)
+
+#define PT_SEMAFORO_AGUARDA(pt, sem)									\
+	PT_ESPERA_EVENTO((pt), &(sem)->evento, PtSemaforoTentaAguardar(sem))
+
+#define PT_ESPERA_MARCAS(pt, marcas)									\
+	do { PtAtrasa((pt), (marcas)); (pt)->lc = __LINE__;					\
+	return PT_WAITING; case __LINE__:; } while(0)
+
+/* semaforo do kernel: sem unidade disponivel, a protothread bloqueia e a
+   tarefa do escalonador obtem a unidade por ela antes de continua-la */
+#define PT_ESPERA_SEMAFORO(pt, sem)										\
+	do { if(SemaforoTentaAguardar(sem) != STATUS_OK) {					\
+	PtAguardaSemaforo((pt), (sem)); (pt)->lc = __LINE__;				\
+	return PT_WAITING; case __LINE__:; } } while(0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PT_ESCALONADOR_H_ */
@@ -0,0 +1,39 @@
+/*
+ * pt.h
+ *
+ * Protothreads: threads sem pilha propria baseadas em continuacoes locais
+ * (switch/case com o numero da linha), como em Protothreads/main.c.
+ *
+ * Variaveis locais nao sobrevivem a um ponto de espera (PT_WAIT_UNTIL,
+ * PT_YIELD, ...) e devem ser static ou ficar na estrutura da protothread.
+ * Nao usar switch dentro de uma protothread entre PT_BEGIN e PT_END.
+ */
+
+#ifndef PT_H_
+#define PT_H_
+
+struct pt {
+  unsigned short lc;
+};
+
+#define PT_INIT(pt)   ((pt)->lc = 0)
+#define PT_THREAD(name_args) char name_args
+#define PT_WAITING 0
+#define PT_YIELDED 1
+#define PT_EXITED  2
+#define PT_ENDED   3
+
+#define PT_BEGIN(pt) { char PT_YIELD_FLAG = 1; (void)PT_YIELD_FLAG; switch((pt)->lc) { case 0:
+#define PT_END(pt)   } PT_YIELD_FLAG = 0; (pt)->lc = 0; return PT_ENDED; }
+#define PT_WAIT_UNTIL(pt, condition) \
+  do { (pt)->lc = __LINE__; case __LINE__: \
+  if(!(condition)) { return PT_WAITING; } } while(0)
+#define PT_WAIT_WHILE(pt, cond)  PT_WAIT_UNTIL((pt), !(cond))
+#define PT_YIELD(pt) \
+  do { PT_YIELD_FLAG = 0; (pt)->lc = __LINE__; case __LINE__: \
+  if(PT_YIELD_FLAG == 0) { return PT_YIELDED; } } while(0)
+#define PT_EXIT(pt) \
+  do { PT_INIT(pt); return PT_EXITED; } while(0)
+#define PT_SCHEDULE(f) ((f) < PT_EXITED)
+
+#endif /* PT_H_ */
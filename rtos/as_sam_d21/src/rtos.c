@@ -9,14 +9,121 @@
 uint8_t 	   tarefa_atual, proxima_tarefa;
 tcb_t   	   TCB[NUMERO_DE_TAREFAS+1];
 stackptr_t	   ponteiro_de_pilha;
+#if !cfg_TABELA_ESTATICA
 prioridade_t   Prioridades[PRIORIDADE_MAXIMA+1];   /* vetor com as prioridades das tarefas */
-uint32_t	   SP;
+#endif
+stackptr_t	   SP;
+
+#if cfg_MEDE_CUSTOS
+uint32_t	   custo_max_marca_tempo = 0;
+uint32_t	   custo_max_troca_contexto = 0;
+#endif
+
+_Static_assert(PRIORIDADE_MAXIMA < 32, "PRIORIDADE_MAXIMA maior que o numero de bits de lista_espera_t");
+
+/* bit da tarefa nas listas de espera */
+#define BIT_ESPERA(tarefa)		(1UL << TCB[tarefa].prioridade)
+
+/* travas de leitura e escrita obtidas pela tarefa: os leitores nao sao
+   identificados na trava, logo uma tarefa que as detem nao e eliminada */
+#if cfg_PILHA_ESTOURO_ACAO == PILHA_ESTOURO_ELIMINA
+#define TRAVAS_CONTA(tarefa, n)	(TCB[tarefa].travas += (n))
+#else
+#define TRAVAS_CONTA(tarefa, n)
+#endif
 
 /* variavel auxiliar para guardar o numero de marcas de tempo */
 static tick_t contador_marcas = 0;
 
 static uint8_t numero_tarefas = 0;
 
+/* bloqueio do escalonador: nivel de aninhamento e troca de contexto adiada */
+static volatile uint8_t escalonador_bloqueado = 0;
+static volatile uint8_t troca_adiada = 0;
+
+volatile uint8_t troca_pendente_isr = 0;
+
+/* servicos que colocam a tarefa em espera nao podem ser chamados dentro de
+   outra regiao critica nem com o escalonador bloqueado: a troca de contexto
+   ficaria adiada e a tarefa continuaria sem ter esperado (ou repetiria a
+   espera indefinidamente, com as interrupcoes desabilitadas) */
+#define PODE_BLOQUEAR()		(!REG_ATOMICA_ANINHADA() && escalonador_bloqueado == 0)
+
+/* prioridade que uma tarefa iniciada precisa superar para preempta-la: o
+   limiar e a heranca dos mutexes, ou apenas a prioridade sem limiar */
+#if cfg_LIMIAR_PREEMPCAO
+#define LIMIAR_EFETIVO(tarefa)	(TCB[tarefa].heranca > TCB[tarefa].limiar ? TCB[tarefa].heranca : TCB[tarefa].limiar)
+#else
+#define LIMIAR_EFETIVO(tarefa)	(TCB[tarefa].prioridade)
+#endif
+
+/* a tarefa acordada preempta a atual? So vale quando chamado pela propria
+   tarefa atual; em interrupcoes a troca e sempre solicitada */
+#define PREEMPTA_ATUAL(tarefa)	(TCB[tarefa].prioridade > LIMIAR_EFETIVO(tarefa_atual))
+
+#if cfg_ESTATISTICAS
+estatisticas_kernel_t EstatisticasKernel;
+
+/* semaforos registrados para inspecao, com nome */
+static struct
+{
+	semaforo_t	*sem;
+	const char	*nome;
+} semaforos_registrados[cfg_ESTATISTICAS_SEMAFOROS];
+static uint8_t numero_semaforos = 0;
+#endif
+
+#if cfg_PARTICOES
+uint16_t	   ParticaoEstouros[cfg_PARTICOES+1];
+
+/* tabela de janelas, janela atual e marcas de tempo que faltam para o fim dela */
+static const janela_particao_t *janelas = NULL;
+static uint8_t numero_janelas = 0;
+static uint8_t janela_atual = 0;
+static tick_t  marcas_janela = 0;
+static uint8_t particao_ativa = 0;
+
+/* tarefas da particao 0 executam em todas as janelas */
+#define NA_PARTICAO_ATIVA(tarefa)	(TCB[tarefa].particao == 0 || TCB[tarefa].particao == particao_ativa)
+#else
+#define NA_PARTICAO_ATIVA(tarefa)	(1)
+#endif
+
+#if cfg_SERVIDORES
+/**
+* \struct servidor_t
+* Servidor esporadico: o orcamento consumido em cada ativacao (desde a primeira
+* execucao ate bloquear ou esgotar) e reposto um periodo depois do inicio dela
+*/
+
+typedef struct
+{
+	tick_t		orcamento_maximo;
+	tick_t		periodo;
+	tick_t		orcamento;			/* marcas de tempo ainda disponiveis */
+	tick_t		inicio;				/* marca do inicio da ativacao atual */
+	tick_t		consumido;			/* marcas consumidas na ativacao atual */
+	uint8_t		ativado;
+	uint8_t		primeira, quantidade;
+	struct
+	{
+		tick_t	instante;
+		tick_t	marcas;
+	} reposicoes[cfg_SERVIDOR_REPOSICOES];	/* em ordem de instante */
+	uint16_t	esgotamentos;
+} servidor_t;
+
+static servidor_t servidores[cfg_SERVIDORES];
+static uint8_t numero_servidores = 0;
+
+#define COM_ORCAMENTO(tarefa)		(TCB[tarefa].servidor == 0 || servidores[TCB[tarefa].servidor - 1].orcamento > 0)
+#else
+#define COM_ORCAMENTO(tarefa)		(1)
+#endif
+
+/* tarefa pode ser escolhida pelo escalonador */
+#define ELEGIVEL(tarefa)			(NA_PARTICAO_ATIVA(tarefa) && COM_ORCAMENTO(tarefa))
+
 /* codigo independente de hardware */
 /* funcao para realizar o escalonamento de tarefas por prioridades 
    que retorna a proxima tarefa que sera executada, isto e, aquela que
@@ -28,6 +135,40 @@ uint8_t escalonador(void)
 	uint8_t prioridade;
 	uint8_t tarefa_selecionada = 0;
     
+#if cfg_LIMIAR_PREEMPCAO
+	prioridade_t maior_efetiva = 0;
+	uint8_t tarefa;
+
+	/* a prioridade efetiva de uma tarefa pronta ja iniciada (em execucao ou
+	   preemptada) e o seu limiar: tarefas com prioridade ate esse limiar nao
+	   a preemptam. Em caso de empate, a tarefa iniciada continua */
+	for (prioridade=PRIORIDADE_MAXIMA;prioridade>0;prioridade--)
+	{
+		tarefa = Prioridades[prioridade];
+		if(tarefa != 0 && TCB[tarefa].estado == PRONTA && ELEGIVEL(tarefa))
+		{
+			prioridade_t efetiva = TCB[tarefa].iniciada ? TCB[tarefa].limiar : prioridade;
+
+			/* a heranca de prioridade dos mutexes vale mesmo sem a tarefa ter iniciado */
+			if(TCB[tarefa].heranca > efetiva)
+			{
+				efetiva = TCB[tarefa].heranca;
+			}
+
+			if(tarefa_selecionada == 0 || efetiva > maior_efetiva ||
+			   (efetiva == maior_efetiva && TCB[tarefa].iniciada))
+			{
+				tarefa_selecionada = tarefa;
+				maior_efetiva = efetiva;
+			}
+		}
+	}
+
+	if(tarefa_selecionada != 0)
+	{
+		return tarefa_selecionada;
+	}
+#else
 	/* comeca pela maior prioridade ate encontrar 
 	uma tarefa em estado de pronta para executar  */	
     for (prioridade=PRIORIDADE_MAXIMA;prioridade>0;prioridade--)
@@ -35,20 +176,18 @@ uint8_t escalonador(void)
       if(Prioridades[prioridade] != 0)
 	  {        
         tarefa_selecionada = Prioridades[prioridade];
-        if(TCB[tarefa_selecionada].estado == PRONTA)
+        if(TCB[tarefa_selecionada].estado == PRONTA && ELEGIVEL(tarefa_selecionada))
 		{    
 		 /* retorna aquela que tem a maior prioridade e que esta pronta para executar */		
           return tarefa_selecionada;    
         }
       }
     } 
+#endif
     
 	/* caso nenhuma esteja pronta para executar, retorna a de menor prioridade, 
 	 a qual sempre deve estar pronta para executar */
-    if(prioridade == 0) 
-	{
-    	tarefa_selecionada = Prioridades[prioridade];
-    }
+	tarefa_selecionada = Prioridades[0];
 	
 	return tarefa_selecionada;
 }
@@ -56,14 +195,42 @@ uint8_t escalonador(void)
 
 
 /*********************************************/
-void CriaTarefa(tarefa_t p, const char * nome,
+/* prepara a pilha e o bloco de controle da tarefa; retorna o numero da tarefa
+   ou 0 se a tabela de tarefas (NUMERO_DE_TAREFAS) estiver cheia */
+static uint8_t InstalaTarefa(tarefa_t p, const char * nome,
 stackptr_t pilha, uint16_t tamanho, prioridade_t prioridade)
 {
 	
-	if(tamanho < TAM_MINIMO_PILHA)
+	stackptr_t base = pilha;
+	
+	if(numero_tarefas >= NUMERO_DE_TAREFAS)
 	{
-		return;
+		return 0;
+	}
+	
+#if cfg_PILHA_PALAVRAS_GUARDA > 0
+	{
+		uint8_t palavra;
+		
+		/* palavras de guarda no fundo da pilha */
+		for(palavra = 0; palavra < cfg_PILHA_PALAVRAS_GUARDA; palavra++)
+		{
+			base[palavra] = PILHA_PADRAO_GUARDA;
+		}
+	}
+#endif
+
+#if cfg_ESTATISTICAS
+	{
+		uint16_t palavra;
+		
+		/* o restante da pilha recebe o padrao de livre, sobrescrito com o uso */
+		for(palavra = cfg_PILHA_PALAVRAS_GUARDA; palavra < tamanho; palavra++)
+		{
+			base[palavra] = PILHA_PADRAO_LIVRE;
+		}
 	}
+#endif
 	
 	pilha = CriaContexto(p, pilha + tamanho);
 	
@@ -72,15 +239,77 @@ stackptr_t pilha, uint16_t tamanho, prioridade_t prioridade)
 
 	/* guardar os dados no bloco de controle da tarefa (TCB) */
 	TCB[numero_tarefas].nome = nome;
+	TCB[numero_tarefas].base_pilha = base;
 	TCB[numero_tarefas].stack_pointer = (stackptr_t)(pilha);
 	TCB[numero_tarefas].estado = PRONTA;
 	TCB[numero_tarefas].prioridade = prioridade;
+	TCB[numero_tarefas].limiar = prioridade;
+	TCB[numero_tarefas].iniciada = 0;
+	TCB[numero_tarefas].mutexes = NULL;
+	TCB[numero_tarefas].espera = NULL;
+	TCB[numero_tarefas].espera_qualquer = NULL;
+#if cfg_LIMIAR_PREEMPCAO
+	TCB[numero_tarefas].limiar_base = prioridade;
+	TCB[numero_tarefas].recursos = NULL;
+	TCB[numero_tarefas].heranca = 0;
+	TCB[numero_tarefas].aguarda_mutex = NULL;
+#endif
 	TCB[numero_tarefas].tempo_espera = 0;
-	  
+#if cfg_PARTICOES
+	TCB[numero_tarefas].particao = 0;
+	TCB[numero_tarefas].aguarda_janela = 0;
+#endif
+#if cfg_SERVIDORES
+	TCB[numero_tarefas].servidor = 0;
+#endif
+#if cfg_PILHA_ESTOURO_ACAO == PILHA_ESTOURO_ELIMINA
+	TCB[numero_tarefas].travas = 0;
+#endif
+#if cfg_NOTIFICACOES
+	TCB[numero_tarefas].notificacao = 0;
+	TCB[numero_tarefas].aguarda_notificacao = 0;
+#endif
+#if cfg_ESTATISTICAS
+	TCB[numero_tarefas].marcas_cpu = 0;
+	TCB[numero_tarefas].prazos_perdidos = 0;
+#endif
+	
+	return numero_tarefas;
+}
+
+void CriaTarefa(tarefa_t p, const char * nome,
+stackptr_t pilha, uint16_t tamanho, prioridade_t prioridade)
+{
+	uint8_t id_tarefa;
+	
+	if(tamanho < TAM_MINIMO_PILHA + cfg_PILHA_PALAVRAS_GUARDA)
+	{
+		return;
+	}
+	
 	/* guardar o numero da tarefa (TCB) no vetor de prioridades das tarefas */
-	Prioridades[prioridade]=numero_tarefas;
+	id_tarefa = InstalaTarefa(p, nome, pilha, tamanho, prioridade);
+	if(id_tarefa != 0)
+	{
+		Prioridades[prioridade] = id_tarefa;
+	}
+
+}
 
+#if cfg_TABELA_ESTATICA
+/* Cria as tarefas da tabela estatica. Os numeros das tarefas seguem a ordem da
+   tabela e o vetor de prioridades ja foi preenchido em tempo de compilacao. */
+void IniciaTarefasEstaticas(void)
+{
+	uint8_t i;
+	
+	for(i = 0; i < NumeroTarefasEstaticas; i++)
+	{
+		const tarefa_estatica_t *t = &TabelaDeTarefas[i];
+		(void)InstalaTarefa(t->funcao, t->nome, t->pilha, t->tamanho, t->prioridade);
+	}
 }
+#endif
 
 
 
@@ -106,6 +335,7 @@ void TarefaEspera(tick_t qtas_marcas)
 	if(qtas_marcas > 0)  //** so valores maiores que 0 */
 	{
 		REG_ATOMICA_INICIO();			/* bloqueia interrupcoes */
+		Assert(PODE_BLOQUEAR());
 		TCB[tarefa_atual].tempo_espera = qtas_marcas;	/* contador de marcas da tarefa iniciado com o valor recebido */
 		TCB[tarefa_atual].estado = ESPERA;				/* tarefa colocada na fila de espera */
 		TrocaContexto(); 	 /* tarefa atual solicita troca de contexto, so retorna quando ficar pronta novamente */
@@ -113,105 +343,1589 @@ void TarefaEspera(tick_t qtas_marcas)
 	}
 }
 
-/* Exemplo de tarefa ociosa */
-void tarefa_ociosa(void)
+static void MutexRecalculaHeranca(uint8_t tarefa);
+
+#if cfg_LIMIAR_PREEMPCAO
+/* limiar da tarefa: o limiar base ou o maior teto dos recursos que ela detem */
+static void LimiarRecalcula(uint8_t tarefa)
 {
+	recurso_t *recurso;
 	
-	for(;;)
-	{		
-		#if 1
-			REG_ATOMICA_INICIO();
-			TrocaContexto();				/* tarefa atual solicita troca de contexto */
-			REG_ATOMICA_FIM();
-		#endif
+	TCB[tarefa].limiar = TCB[tarefa].limiar_base;
+	for(recurso = TCB[tarefa].recursos; recurso != NULL; recurso = recurso->anterior)
+	{
+		if(recurso->teto > TCB[tarefa].limiar)
+		{
+			TCB[tarefa].limiar = recurso->teto;
+		}
 	}
 }
+#endif
 
-
-void IniciaMultitarefas(void)
+/* passa o bit da tarefa na lista de espera de antigo para novo */
+static void ListaEsperaMudaBit(lista_espera_t* lista, lista_espera_t antigo, lista_espera_t novo)
 {
-	tarefa_atual = escalonador();
-	ponteiro_de_pilha = TCB[tarefa_atual].stack_pointer;
-	SP = ponteiro_de_pilha;
-	GERA_INTERRUPCAO_SW();
+	if(*lista & antigo)
+	{
+		*lista = (*lista & ~antigo) | novo;
+	}
 }
 
-void TrocaContextoDasTarefas(void)
+/* Altera a prioridade de uma tarefa em tempo de execucao. A tarefa pode estar
+   pronta, em espera por tempo ou bloqueada: o seu bit nas listas de espera,
+   que e o da prioridade, passa para a nova prioridade. Cada prioridade
+   admite uma unica tarefa, logo a nova prioridade deve estar livre. Um limiar
+   base igual a prioridade a acompanha; um limiar definido acima dela e
+   mantido, mas nunca fica abaixo da nova prioridade. */
+enum status_code TarefaMudaPrioridade(uint8_t id_tarefa, prioridade_t nova_prioridade)
 {
+	prioridade_t prioridade_antiga;
 	
-	/* guarda o valor antigo do stack pointer */
-	TCB[tarefa_atual].stack_pointer = SP;
-		
-	/* executa o escalonador */
-	proxima_tarefa = escalonador();
-		
-	/* seleciona a nova tarefa */
-	tarefa_atual = proxima_tarefa;
-		
-	/* coloca um novo valor no stack pointer */
-	ponteiro_de_pilha = TCB[tarefa_atual].stack_pointer;
-		
-	SP = ponteiro_de_pilha;
-
-}
-void ExecutaMarcaDeTempo(void)
-{
+	/* a prioridade 0 e reservada para a tarefa ociosa */
+	if(id_tarefa == 0 || id_tarefa > numero_tarefas ||
+	   nova_prioridade == 0 || nova_prioridade > PRIORIDADE_MAXIMA ||
+	   TCB[id_tarefa].prioridade == 0)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
 	
-	uint8_t tarefa = 0;
-		
-	++contador_marcas; /* incrementa contador de marcas de tempo */
+	REG_ATOMICA_INICIO();
 	
-	/* laco para decrementar tempo de espera das tarefas 
-	 * e coloca-las na fila de prontas para executar  */	
-	for (tarefa=numero_tarefas;tarefa > 0;tarefa--)
-	{ 
-	  
-		if(TCB[tarefa].tempo_espera > 0 ) /* se esta esperando algum tempo */
-		{	
-			TCB[tarefa].tempo_espera--; /* decrementa tempo de espera */
+	prioridade_antiga = TCB[id_tarefa].prioridade;
+	if(nova_prioridade != prioridade_antiga)
+	{
+		if(Prioridades[nova_prioridade] != 0)
+		{
+			REG_ATOMICA_FIM();
+			return STATUS_ERR_DENIED;		/* prioridade ocupada por outra tarefa */
+		}
+		
+		/* move a tarefa para a nova posicao do vetor de prioridades e das
+		   listas de espera em que estiver */
+		if(TCB[id_tarefa].espera != NULL)
+		{
+			ListaEsperaMudaBit(TCB[id_tarefa].espera, 1UL << prioridade_antiga, 1UL << nova_prioridade);
+		}
+		if(TCB[id_tarefa].espera_qualquer != NULL)
+		{
+			uint8_t i;
 			
-			if(TCB[tarefa].tempo_espera == 0 )
+			for(i = 0; i < TCB[id_tarefa].espera_numero; i++)
 			{
-				/* coloca a tarefa na fila de prontas para executar */	
-				TCB[tarefa].estado = PRONTA;	        				
+				ListaEsperaMudaBit(&TCB[id_tarefa].espera_qualquer[i]->tarefasEsperando,
+								   1UL << prioridade_antiga, 1UL << nova_prioridade);
 			}
 		}
-	 }
+		Prioridades[prioridade_antiga] = 0;
+		Prioridades[nova_prioridade] = id_tarefa;
+		TCB[id_tarefa].prioridade = nova_prioridade;
+#if cfg_LIMIAR_PREEMPCAO
+		if(TCB[id_tarefa].limiar_base == prioridade_antiga || TCB[id_tarefa].limiar_base < nova_prioridade)
+		{
+			TCB[id_tarefa].limiar_base = nova_prioridade;
+		}
+		LimiarRecalcula(id_tarefa);
+		
+		/* a dona do mutex que a tarefa espera herda a nova prioridade */
+		if(TCB[id_tarefa].aguarda_mutex != NULL)
+		{
+			MutexRecalculaHeranca(TCB[id_tarefa].aguarda_mutex->dona);
+		}
+#else
+		TCB[id_tarefa].limiar = nova_prioridade;
+#endif
+		
+		TrocaContexto();	/* reavalia a preempcao com a nova prioridade */
+	}
+	
+	REG_ATOMICA_FIM();
+	return STATUS_OK;
 }
 
-/* Servicos de semaforos */
-void SemaforoAguarda(semaforo_t* sem)
+#if cfg_LIMIAR_PREEMPCAO
+/* Define o limiar de preempcao da tarefa, entre a sua prioridade e
+   PRIORIDADE_MAXIMA (como no ThreadX). Enquanto iniciada, a tarefa so e
+   preemptada por tarefas com prioridade maior que o limiar, o que evita trocas
+   de contexto entre tarefas de um mesmo subsistema. Com o limiar igual a
+   prioridade o comportamento e o do escalonador por prioridades fixas. */
+enum status_code TarefaDefineLimiar(uint8_t id_tarefa, prioridade_t limiar)
 {
-	
+	if(id_tarefa == 0 || id_tarefa > numero_tarefas || TCB[id_tarefa].prioridade == 0 ||
+	   limiar < TCB[id_tarefa].prioridade || limiar > PRIORIDADE_MAXIMA)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+
 	REG_ATOMICA_INICIO();
-	
-	if(sem->contador > 0)
+	TCB[id_tarefa].limiar_base = limiar;
+	LimiarRecalcula(id_tarefa);		/* os recursos obtidos continuam valendo */
+	TrocaContexto();	/* um limiar menor pode liberar uma preempcao */
+	REG_ATOMICA_FIM();
+
+	return STATUS_OK;
+}
+
+/* Obtem o recurso elevando o limiar da tarefa atual ao teto, em tempo
+   constante e sem passar pelo escalonador */
+enum status_code RecursoObtem(recurso_t* recurso)
+{
+	if(TCB[tarefa_atual].prioridade > recurso->teto)
 	{
-		sem->contador--;
-	}else
+		return STATUS_ERR_INVALID_ARG;		/* teto calculado sem esta tarefa */
+	}
+	if(recurso->tarefa != 0)
 	{
-		TCB[tarefa_atual].estado = ESPERA;		/* tarefa colocada na fila de espera */
-		sem->tarefaEsperando = tarefa_atual;   	/* tarefa colocada na espera do semaforo */
-		TROCA_CONTEXTO();						/* solicita troca de contexto */
+		return STATUS_ERR_DENIED;			/* ja obtido (obtencao repetida) */
+	}
+
+	REG_ATOMICA_INICIO();
+	recurso->tarefa = tarefa_atual;
+	recurso->anterior = TCB[tarefa_atual].recursos;
+	TCB[tarefa_atual].recursos = recurso;
+	if(recurso->teto > TCB[tarefa_atual].limiar)
+	{
+		TCB[tarefa_atual].limiar = recurso->teto;
+	}
+	REG_ATOMICA_FIM();
+
+	return STATUS_OK;
+}
+
+/* Libera o recurso e restaura o limiar, recalculado com o limiar base atual
+   (a prioridade pode ter mudado desde a obtencao); tarefas que ficaram prontas
+   com prioridade ate o teto podem entao preemptar a tarefa atual */
+enum status_code RecursoLibera(recurso_t* recurso)
+{
+	prioridade_t limiar;
+
+	if(recurso->tarefa != tarefa_atual || TCB[tarefa_atual].recursos != recurso)
+	{
+		return STATUS_ERR_DENIED;		/* nao obtido ou fora da ordem inversa */
+	}
+
+	REG_ATOMICA_INICIO();
+	recurso->tarefa = 0;
+	TCB[tarefa_atual].recursos = recurso->anterior;
+	recurso->anterior = NULL;
+	limiar = TCB[tarefa_atual].limiar;
+	LimiarRecalcula(tarefa_atual);
+	if(TCB[tarefa_atual].limiar != limiar)
+	{
+		TrocaContexto();
 	}
-	
 	REG_ATOMICA_FIM();
+
+	return STATUS_OK;
 }
+#endif
+
+#if cfg_PARTICOES
+/* Inicia o escalonamento por particoes de tempo com a tabela de janelas, que
+   deve permanecer valida (normalmente const, na memoria flash). A primeira
+   janela comeca na proxima marca de tempo. */
+enum status_code ParticoesInicia(const janela_particao_t *tabela, uint8_t numero)
+{
+	uint8_t janela;
+
+	if(tabela == NULL || numero == 0)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+	for(janela = 0; janela < numero; janela++)
+	{
+		if(tabela[janela].marcas == 0 || tabela[janela].particao > cfg_PARTICOES)
+		{
+			return STATUS_ERR_INVALID_ARG;
+		}
+	}
 
+	REG_ATOMICA_INICIO();
+	janelas = tabela;
+	numero_janelas = numero;
+	janela_atual = numero - 1;
+	marcas_janela = 1;
+	REG_ATOMICA_FIM();
+
+	return STATUS_OK;
+}
 
-void SemaforoLibera(semaforo_t* sem)
+/* Associa a tarefa a uma particao (0: executa em todas as janelas). A tarefa
+   ociosa deve permanecer na particao 0. */
+enum status_code TarefaDefineParticao(uint8_t id_tarefa, uint8_t particao)
 {
+	if(id_tarefa == 0 || id_tarefa > numero_tarefas || TCB[id_tarefa].prioridade == 0 ||
+	   particao > cfg_PARTICOES)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+
 	REG_ATOMICA_INICIO();
-	
-	if(sem->tarefaEsperando > 0)
-	{	/* tem alguma tarefa aguardando ? */
-		TCB[sem->tarefaEsperando].estado = PRONTA;		/* tarefa colocada na fila de pronta */
-		sem->tarefaEsperando = 0;						/* tarefa retirada da espera do semaforo */
-	}else
+	TCB[id_tarefa].particao = particao;
+	TrocaContexto();
+	REG_ATOMICA_FIM();
+
+	return STATUS_OK;
+}
+
+/* A tarefa atual espera o inicio da proxima janela da sua particao, onde e
+   liberada na propria marca de tempo, sem variacao (jitter) da ativacao.
+   Usada no fim de cada ciclo das malhas de controle. */
+void ParticaoAguardaJanela(void)
+{
+	if(TCB[tarefa_atual].particao == 0)
 	{
-		sem->contador++;
+		return;
 	}
-	TROCA_CONTEXTO();
-	
+
+	REG_ATOMICA_INICIO();
+	TCB[tarefa_atual].aguarda_janela = 1;
+	TCB[tarefa_atual].estado = ESPERA;
+	TrocaContexto();
 	REG_ATOMICA_FIM();
 }
+
+uint8_t ParticaoAtiva(void)
+{
+	return particao_ativa;
+}
+
+/* Gancho padrao para estouro de janela: a aplicacao pode redefini-lo.
+   E chamado na interrupcao da marca de tempo. */
+__attribute__((weak)) void ParticaoEstouroGancho(uint8_t particao)
+{
+	(void)particao;
+}
+
+/* Fim da janela atual: verifica o estouro da particao que termina, ativa a
+   proxima janela e libera as tarefas que aguardam por ela */
+static void TrocaJanela(void)
+{
+	uint8_t tarefa;
+
+	if(particao_ativa != 0)
+	{
+		for(tarefa = numero_tarefas; tarefa > 0; tarefa--)
+		{
+			if(TCB[tarefa].particao == particao_ativa && TCB[tarefa].estado == PRONTA)
+			{
+				ParticaoEstouros[particao_ativa]++;
+				ParticaoEstouroGancho(particao_ativa);
+				break;
+			}
+		}
+	}
+
+	janela_atual = (uint8_t)((janela_atual + 1) % numero_janelas);
+	marcas_janela = janelas[janela_atual].marcas;
+	particao_ativa = janelas[janela_atual].particao;
+
+	for(tarefa = numero_tarefas; tarefa > 0; tarefa--)
+	{
+		if(TCB[tarefa].aguarda_janela && TCB[tarefa].particao == particao_ativa)
+		{
+			TCB[tarefa].aguarda_janela = 0;
+			TCB[tarefa].estado = PRONTA;
+		}
+	}
+
+	/* a marca de tempo nao preempta no modo cooperativo (cfg_PREEMPCAO_NA_MARCA),
+	   mas a troca de janela sempre preempta */
+	TrocaContexto();
+}
+#endif
+
+#if cfg_SERVIDORES
+/* Limita a tarefa a orcamento marcas de tempo de processador a cada periodo
+   (servidor esporadico), para atender eventos aperiodicos com a prioridade da
+   tarefa sem atrasar as tarefas de menor prioridade alem do orcamento. Com o
+   orcamento esgotado a tarefa nao e escalonada ate a reposicao. */
+enum status_code TarefaDefineServidor(uint8_t id_tarefa, tick_t orcamento, tick_t periodo)
+{
+	servidor_t *servidor;
+
+	if(id_tarefa == 0 || id_tarefa > numero_tarefas || TCB[id_tarefa].prioridade == 0 ||
+	   orcamento == 0 || orcamento > periodo || periodo >= MARCAS_INDEFINIDAS / 2)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+
+	REG_ATOMICA_INICIO();
+
+	if(TCB[id_tarefa].servidor == 0)
+	{
+		if(numero_servidores == cfg_SERVIDORES)
+		{
+			REG_ATOMICA_FIM();
+			return STATUS_ERR_NO_MEMORY;
+		}
+		TCB[id_tarefa].servidor = ++numero_servidores;
+	}
+
+	servidor = &servidores[TCB[id_tarefa].servidor - 1];
+	servidor->orcamento_maximo = orcamento;
+	servidor->periodo = periodo;
+	servidor->orcamento = orcamento;
+	servidor->ativado = 0;
+	servidor->quantidade = 0;
+	TrocaContexto();
+
+	REG_ATOMICA_FIM();
+
+	return STATUS_OK;
+}
+
+tick_t ServidorOrcamento(uint8_t id_tarefa)
+{
+	return TCB[id_tarefa].servidor ? servidores[TCB[id_tarefa].servidor - 1].orcamento : MARCAS_INDEFINIDAS;
+}
+
+uint16_t ServidorEsgotamentos(uint8_t id_tarefa)
+{
+	return TCB[id_tarefa].servidor ? servidores[TCB[id_tarefa].servidor - 1].esgotamentos : 0;
+}
+
+static void ServidorRepoe(servidor_t *servidor, tick_t marcas)
+{
+	servidor->orcamento += marcas;
+	if(servidor->orcamento > servidor->orcamento_maximo)
+	{
+		servidor->orcamento = servidor->orcamento_maximo;
+	}
+}
+
+/* fim da ativacao (tarefa bloqueou ou esgotou o orcamento): agenda a reposicao
+   do que foi consumido para um periodo depois do inicio da ativacao */
+static void ServidorEncerraAtivacao(servidor_t *servidor)
+{
+	tick_t instante = (tick_t)(servidor->inicio + servidor->periodo);
+
+	servidor->ativado = 0;
+	if(servidor->consumido == 0)
+	{
+		return;
+	}
+
+	if((tick_t)(contador_marcas - servidor->inicio) >= servidor->periodo)
+	{
+		/* a ativacao durou mais que o periodo: a reposicao ja venceu */
+		ServidorRepoe(servidor, servidor->consumido);
+	}
+	else if(servidor->quantidade == cfg_SERVIDOR_REPOSICOES)
+	{
+		/* sem espaco: soma a ultima reposicao, que ocorre mais tarde */
+		uint8_t ultima = (uint8_t)((servidor->primeira + servidor->quantidade - 1) % cfg_SERVIDOR_REPOSICOES);
+		servidor->reposicoes[ultima].instante = instante;
+		servidor->reposicoes[ultima].marcas += servidor->consumido;
+	}
+	else
+	{
+		uint8_t nova = (uint8_t)((servidor->primeira + servidor->quantidade) % cfg_SERVIDOR_REPOSICOES);
+		servidor->reposicoes[nova].instante = instante;
+		servidor->reposicoes[nova].marcas = servidor->consumido;
+		servidor->quantidade++;
+	}
+}
+
+/* contabiliza a marca de tempo para a tarefa em execucao e aplica as reposicoes vencidas */
+static void ServidoresMarcaDeTempo(void)
+{
+	servidor_t *servidor;
+
+	if(TCB[tarefa_atual].servidor != 0 && TCB[tarefa_atual].estado == PRONTA)
+	{
+		servidor = &servidores[TCB[tarefa_atual].servidor - 1];
+		if(servidor->ativado && servidor->orcamento > 0)
+		{
+			servidor->orcamento--;
+			servidor->consumido++;
+			if(servidor->orcamento == 0)
+			{
+				servidor->esgotamentos++;
+				ServidorEncerraAtivacao(servidor);
+				TrocaContexto();
+			}
+		}
+	}
+
+	for(servidor = servidores; servidor < &servidores[numero_servidores]; servidor++)
+	{
+		while(servidor->quantidade > 0 &&
+			  servidor->reposicoes[servidor->primeira].instante == contador_marcas)
+		{
+			if(servidor->orcamento == 0)
+			{
+				TrocaContexto();	/* a tarefa volta a ser elegivel */
+			}
+			ServidorRepoe(servidor, servidor->reposicoes[servidor->primeira].marcas);
+			servidor->primeira = (uint8_t)((servidor->primeira + 1) % cfg_SERVIDOR_REPOSICOES);
+			servidor->quantidade--;
+		}
+	}
+}
+#endif
+
+#if cfg_NOTIFICACOES
+/* atualiza a notificacao e acorda a tarefa se ela estiver em NotificacaoRecebe();
+   retorna 1 se a tarefa foi acordada. Chamada em regiao critica */
+static uint8_t NotificacaoEntrega(uint8_t id_tarefa, uint32_t valor, acao_notificacao_t acao)
+{
+	switch(acao)
+	{
+		case NOTIFICA_DA:
+			TCB[id_tarefa].notificacao++;
+			break;
+		case NOTIFICA_BITS:
+			TCB[id_tarefa].notificacao |= valor;
+			break;
+		default:
+			TCB[id_tarefa].notificacao = valor;
+			break;
+	}
+
+	if(TCB[id_tarefa].aguarda_notificacao && TCB[id_tarefa].notificacao != 0)
+	{
+		TCB[id_tarefa].aguarda_notificacao = 0;
+		TCB[id_tarefa].estado = PRONTA;
+		return 1;
+	}
+	return 0;
+}
+
+/* Notifica a tarefa, de outra tarefa ou de uma interrupcao. Acorda a tarefa se
+   ela estiver em NotificacaoRecebe(); chamada de uma tarefa, so solicita a
+   troca de contexto se a tarefa acordada a preempta. Em uma interrupcao a
+   troca e sempre solicitada: a tarefa interrompida pode ter acabado de
+   bloquear, ou o escalonador pode ter sido interrompido, e so o escalonador
+   decide com o estado atualizado */
+enum status_code TarefaNotifica(uint8_t id_tarefa, uint32_t valor, acao_notificacao_t acao)
+{
+	if(id_tarefa == 0 || id_tarefa > numero_tarefas)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+
+	REG_ATOMICA_INICIO();
+
+	if(NotificacaoEntrega(id_tarefa, valor, acao) &&
+	   (EM_INTERRUPCAO() || PREEMPTA_ATUAL(id_tarefa)))
+	{
+		TrocaContexto();
+	}
+
+	REG_ATOMICA_FIM();
+
+	return STATUS_OK;
+}
+
+/* Como TarefaNotifica(), somente para rotinas de interrupcao: se a tarefa for
+   acordada, a troca de contexto fica pendente ate FIM_DE_INTERRUPCAO() */
+enum status_code TarefaNotificaISR(uint8_t id_tarefa, uint32_t valor, acao_notificacao_t acao)
+{
+	if(id_tarefa == 0 || id_tarefa > numero_tarefas)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+
+	REG_ATOMICA_ISR_INICIO(estado);
+
+	if(NotificacaoEntrega(id_tarefa, valor, acao))
+	{
+		troca_pendente_isr = 1;
+	}
+
+	REG_ATOMICA_ISR_FIM(estado);
+
+	return STATUS_OK;
+}
+
+/* Espera ate a notificacao ser diferente de zero e retorna o seu valor. Com
+   zera, o valor volta a zero (semaforo binario, bits de eventos); sem zera, e
+   decrementado (semaforo contador). Retorna 0, sem esperar, se a notificacao
+   for zero e a tarefa nao puder bloquear (dentro de outra regiao critica ou
+   com o escalonador bloqueado) */
+uint32_t NotificacaoRecebe(uint8_t zera)
+{
+	uint32_t valor;
+
+	REG_ATOMICA_INICIO();
+	while(TCB[tarefa_atual].notificacao == 0)
+	{
+		if(!PODE_BLOQUEAR())
+		{
+			Assert(0);
+			REG_ATOMICA_FIM();
+			return 0;
+		}
+		TCB[tarefa_atual].aguarda_notificacao = 1;
+		TCB[tarefa_atual].estado = ESPERA;
+		TrocaContexto();
+		REG_ATOMICA_FIM();		/* a troca de contexto ocorre aqui */
+		REG_ATOMICA_INICIO();
+	}
+
+	valor = TCB[tarefa_atual].notificacao;
+	TCB[tarefa_atual].notificacao = zera ? 0 : valor - 1;
+	REG_ATOMICA_FIM();
+
+	return valor;
+}
+#endif
+
+/* Bloqueio do escalonador: enquanto bloqueado, as trocas de contexto sao adiadas,
+   mas as interrupcoes continuam habilitadas. Pode ser aninhado. A tarefa que
+   bloqueia o escalonador nao deve chamar servicos que a coloquem em espera. */
+void EscalonadorBloqueia(void)
+{
+	/* somente tarefas alteram o contador e uma troca de contexto no meio
+	   da operacao devolve o mesmo valor, logo dispensa regiao atomica */
+	escalonador_bloqueado++;
+}
+
+void EscalonadorLibera(void)
+{
+	if(escalonador_bloqueado > 0)
+	{
+		escalonador_bloqueado--;
+		
+		if(escalonador_bloqueado == 0 && troca_adiada)
+		{
+			troca_adiada = 0;
+			TrocaContexto();	/* executa a troca de contexto adiada */
+		}
+	}
+}
+
+/* Menor numero de marcas de tempo ate alguma tarefa em espera ficar pronta */
+tick_t MarcasAteProximoDespertar(void)
+{
+	tick_t marcas = MARCAS_INDEFINIDAS;
+	uint8_t tarefa;
+	
+	for (tarefa=numero_tarefas;tarefa > 0;tarefa--)
+	{
+		if(TCB[tarefa].estado == ESPERA && TCB[tarefa].tempo_espera > 0 &&
+		   TCB[tarefa].tempo_espera < marcas)
+		{
+			marcas = TCB[tarefa].tempo_espera;
+		}
+	}
+#if cfg_SERVIDORES
+	{
+		const servidor_t *servidor;
+
+		/* e nas reposicoes de orcamento */
+		for(servidor = servidores; servidor < &servidores[numero_servidores]; servidor++)
+		{
+			if(servidor->quantidade > 0 &&
+			   (tick_t)(servidor->reposicoes[servidor->primeira].instante - contador_marcas) < marcas)
+			{
+				marcas = (tick_t)(servidor->reposicoes[servidor->primeira].instante - contador_marcas);
+			}
+		}
+	}
+#endif
+#if cfg_PARTICOES
+	/* a tarefa ociosa deve acordar na troca de janela */
+	if(janelas != NULL && marcas_janela < marcas)
+	{
+		marcas = marcas_janela;
+	}
+#endif
+	return marcas;
+}
+
+/* Numero de marcas de tempo desde o inicio (retorna a zero ao estourar tick_t) */
+tick_t MarcasDeTempo(void)
+{
+	return contador_marcas;
+}
+
+#if cfg_ESTATISTICAS
+/* Estatisticas */
+
+/* menor quantidade de palavras livres que a pilha da tarefa ja teve: palavras
+   acima das de guarda que ainda tem o padrao de livre */
+uint16_t PilhaMinimoLivre(uint8_t id_tarefa)
+{
+	stackptr_t palavra = TCB[id_tarefa].base_pilha + cfg_PILHA_PALAVRAS_GUARDA;
+	uint16_t livres = 0;
+	
+	while(palavra < TCB[id_tarefa].stack_pointer && *palavra == PILHA_PADRAO_LIVRE)
+	{
+		palavra++;
+		livres++;
+	}
+	return livres;
+}
+
+/* Registra um prazo perdido pela tarefa, detectado pela aplicacao (por exemplo,
+   ativacao periodica iniciada depois do fim do periodo) */
+void TarefaPrazoPerdido(uint8_t id_tarefa)
+{
+	REG_ATOMICA_INICIO();
+	TCB[id_tarefa].prazos_perdidos++;
+	EstatisticasKernel.prazos_perdidos++;
+	REG_ATOMICA_FIM();
+}
+
+/* Zera os contadores do kernel e das tarefas; o uso do processador passa a ser
+   medido a partir daqui. A pilha livre nao e zerada */
+void EstatisticasZera(void)
+{
+	uint8_t tarefa;
+	
+	REG_ATOMICA_INICIO();
+	EstatisticasKernel.marcas = 0;
+	EstatisticasKernel.trocas_contexto = 0;
+	EstatisticasKernel.prazos_perdidos = 0;
+	for(tarefa = 0; tarefa <= numero_tarefas; tarefa++)
+	{
+		TCB[tarefa].marcas_cpu = 0;
+		TCB[tarefa].prazos_perdidos = 0;
+	}
+	REG_ATOMICA_FIM();
+}
+
+/* Registra o semaforo com um nome para a inspecao (contador e tarefas esperando) */
+enum status_code SemaforoRegistra(semaforo_t* sem, const char* nome)
+{
+	enum status_code resultado = STATUS_ERR_NO_MEMORY;
+	
+	REG_ATOMICA_INICIO();
+	if(numero_semaforos < cfg_ESTATISTICAS_SEMAFOROS)
+	{
+		semaforos_registrados[numero_semaforos].sem = sem;
+		semaforos_registrados[numero_semaforos].nome = nome;
+		numero_semaforos++;
+		resultado = STATUS_OK;
+	}
+	REG_ATOMICA_FIM();
+	
+	return resultado;
+}
+
+/* semaforo registrado de numero indice e o seu nome (NULL: nao ha) */
+semaforo_t* SemaforoRegistrado(uint8_t indice, const char** nome)
+{
+	if(indice >= numero_semaforos)
+	{
+		return NULL;
+	}
+	*nome = semaforos_registrados[indice].nome;
+	return semaforos_registrados[indice].sem;
+}
+#endif
+
+/* Exemplo de tarefa ociosa */
+void tarefa_ociosa(void)
+{
+	
+	for(;;)
+	{		
+		REG_ATOMICA_INICIO();
+		#if cfg_OCIOSA_BAIXO_CONSUMO
+			if(escalonador() == tarefa_atual)
+			{
+				/* nenhuma tarefa pronta: dorme ate a proxima interrupcao */
+				OciosaDorme(MarcasAteProximoDespertar());
+			}
+			else
+		#endif
+			{
+				TrocaContexto();				/* tarefa atual solicita troca de contexto */
+			}
+		REG_ATOMICA_FIM();
+	}
+}
+
+
+void IniciaMultitarefas(void)
+{
+	tarefa_atual = escalonador();
+	ponteiro_de_pilha = TCB[tarefa_atual].stack_pointer;
+	SP = ponteiro_de_pilha;
+	GERA_INTERRUPCAO_SW();
+}
+
+#if cfg_PILHA_PALAVRAS_GUARDA > 0
+/* Gancho padrao para estouro de pilha: a aplicacao pode redefini-lo.
+   Fica parado aqui para inspecao com o depurador. */
+__attribute__((weak)) void PilhaEstouroGancho(uint8_t id_tarefa)
+{
+	(void)id_tarefa;
+	
+	while(1)
+	{
+	}
+}
+
+/* verifica se a pilha da tarefa ultrapassou o fundo ou corrompeu as palavras de guarda */
+static uint8_t PilhaEstourada(uint8_t id_tarefa)
+{
+	stackptr_t base = TCB[id_tarefa].base_pilha;
+	uint8_t palavra;
+	
+	if(TCB[id_tarefa].stack_pointer < base + cfg_PILHA_PALAVRAS_GUARDA)
+	{
+		return 1;
+	}
+	for(palavra = 0; palavra < cfg_PILHA_PALAVRAS_GUARDA; palavra++)
+	{
+		if(base[palavra] != PILHA_PADRAO_GUARDA)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+#if cfg_PILHA_ESTOURO_ACAO == PILHA_ESTOURO_ELIMINA
+static void MutexRepassa(mutex_t* mutex);
+#endif
+
+static void TrataEstouroDePilha(uint8_t id_tarefa)
+{
+#if cfg_PILHA_ESTOURO_ACAO == PILHA_ESTOURO_ELIMINA
+	/* a tarefa ociosa nao pode ser eliminada, nem uma tarefa com travas de
+	   leitura e escrita, que nao teriam como ser liberadas */
+	if(TCB[id_tarefa].prioridade != 0 && TCB[id_tarefa].travas == 0)
+	{
+		/* retira a tarefa do vetor de prioridades: o contexto salvo nao e mais restaurado */
+		Prioridades[TCB[id_tarefa].prioridade] = 0;
+		TCB[id_tarefa].estado = ESPERA;
+		TCB[id_tarefa].tempo_espera = 0;
+		
+		/* a tarefa sai das listas de espera em que estiver (semaforos,
+		   mutexes, condicoes, travas) e nao recebe mais unidades delas */
+		if(TCB[id_tarefa].espera != NULL)
+		{
+			*TCB[id_tarefa].espera &= ~BIT_ESPERA(id_tarefa);
+			TCB[id_tarefa].espera = NULL;
+		}
+		if(TCB[id_tarefa].espera_qualquer != NULL)
+		{
+			uint8_t i;
+			
+			for(i = 0; i < TCB[id_tarefa].espera_numero; i++)
+			{
+				TCB[id_tarefa].espera_qualquer[i]->tarefasEsperando &= ~BIT_ESPERA(id_tarefa);
+			}
+			TCB[id_tarefa].espera_qualquer = NULL;
+		}
+#if cfg_LIMIAR_PREEMPCAO
+		if(TCB[id_tarefa].aguarda_mutex != NULL)
+		{
+			/* a dona do mutex deixa de herdar a prioridade desta tarefa */
+			uint8_t dona = TCB[id_tarefa].aguarda_mutex->dona;
+			
+			TCB[id_tarefa].aguarda_mutex = NULL;
+			MutexRecalculaHeranca(dona);
+		}
+		
+		/* os recursos ficam livres; o teto nao tem fila de espera */
+		while(TCB[id_tarefa].recursos != NULL)
+		{
+			recurso_t *recurso = TCB[id_tarefa].recursos;
+			
+			TCB[id_tarefa].recursos = recurso->anterior;
+			recurso->anterior = NULL;
+			recurso->tarefa = 0;
+		}
+#endif
+#if cfg_NOTIFICACOES
+		TCB[id_tarefa].aguarda_notificacao = 0;
+#endif
+		
+		/* os mutexes da tarefa passam as tarefas que os esperam; os dados que
+		   eles protegem podem ter ficado inconsistentes */
+		while(TCB[id_tarefa].mutexes != NULL)
+		{
+			MutexRepassa(TCB[id_tarefa].mutexes);
+		}
+		
+		/* a tarefa eliminada pode ter deixado o escalonador bloqueado */
+		escalonador_bloqueado = 0;
+		troca_adiada = 0;
+		return;
+	}
+	REINICIA_SISTEMA();
+#elif cfg_PILHA_ESTOURO_ACAO == PILHA_ESTOURO_REINICIA
+	(void)id_tarefa;
+	REINICIA_SISTEMA();
+#else
+	PilhaEstouroGancho(id_tarefa);
+#endif
+}
+#endif
+
+void TrocaContextoDasTarefas(void)
+{
+	
+#if cfg_MEDE_CUSTOS
+	uint32_t inicio = LE_CONTADOR_CICLOS();
+	uint32_t custo;
+#endif
+
+	/* guarda o valor antigo do stack pointer */
+	TCB[tarefa_atual].stack_pointer = SP;
+		
+#if cfg_PILHA_PALAVRAS_GUARDA > 0
+	if(PilhaEstourada(tarefa_atual))
+	{
+		TrataEstouroDePilha(tarefa_atual);
+	}
+#endif
+		
+	if(escalonador_bloqueado)
+	{
+		/* escalonador bloqueado: a tarefa atual continua e a troca e feita no desbloqueio */
+		troca_adiada = 1;
+	}
+	else
+	{
+		/* a tarefa que bloqueou encerra o trabalho atual e perde o limiar */
+		if(TCB[tarefa_atual].estado != PRONTA)
+		{
+			TCB[tarefa_atual].iniciada = 0;
+#if cfg_SERVIDORES
+			if(TCB[tarefa_atual].servidor != 0 && servidores[TCB[tarefa_atual].servidor - 1].ativado)
+			{
+				ServidorEncerraAtivacao(&servidores[TCB[tarefa_atual].servidor - 1]);
+			}
+#endif
+		}
+		
+		/* executa o escalonador */
+		proxima_tarefa = escalonador();
+		
+#if cfg_ESTATISTICAS
+		if(proxima_tarefa != tarefa_atual)
+		{
+			EstatisticasKernel.trocas_contexto++;
+		}
+#endif
+		
+		/* seleciona a nova tarefa */
+		tarefa_atual = proxima_tarefa;
+		TCB[tarefa_atual].iniciada = 1;
+#if cfg_SERVIDORES
+		if(TCB[tarefa_atual].servidor != 0 && !servidores[TCB[tarefa_atual].servidor - 1].ativado)
+		{
+			/* inicio de uma ativacao do servidor */
+			servidores[TCB[tarefa_atual].servidor - 1].ativado = 1;
+			servidores[TCB[tarefa_atual].servidor - 1].inicio = contador_marcas;
+			servidores[TCB[tarefa_atual].servidor - 1].consumido = 0;
+		}
+#endif
+	}
+		
+	/* coloca um novo valor no stack pointer */
+	ponteiro_de_pilha = TCB[tarefa_atual].stack_pointer;
+		
+	SP = ponteiro_de_pilha;
+
+#if cfg_MEDE_CUSTOS
+	custo = CICLOS_DECORRIDOS(inicio, LE_CONTADOR_CICLOS());
+	if(custo > custo_max_troca_contexto)
+	{
+		custo_max_troca_contexto = custo;
+	}
+#endif
+}
+void ExecutaMarcaDeTempo(void)
+{
+	
+	uint8_t tarefa = 0;
+		
+	++contador_marcas; /* incrementa contador de marcas de tempo */
+	
+#if cfg_ESTATISTICAS
+	/* uso do processador por amostragem: a marca e atribuida a tarefa interrompida */
+	EstatisticasKernel.marcas++;
+	TCB[tarefa_atual].marcas_cpu++;
+#endif
+	
+	/* laco para decrementar tempo de espera das tarefas 
+	 * e coloca-las na fila de prontas para executar  */	
+	for (tarefa=numero_tarefas;tarefa > 0;tarefa--)
+	{ 
+	  
+		if(TCB[tarefa].tempo_espera > 0 ) /* se esta esperando algum tempo */
+		{	
+			TCB[tarefa].tempo_espera--; /* decrementa tempo de espera */
+			
+			if(TCB[tarefa].tempo_espera == 0 )
+			{
+				/* coloca a tarefa na fila de prontas para executar */	
+				TCB[tarefa].estado = PRONTA;	        				
+			}
+		}
+	 }
+
+#if cfg_SERVIDORES
+	ServidoresMarcaDeTempo();
+#endif
+
+#if cfg_PARTICOES
+	if(janelas != NULL && --marcas_janela == 0)
+	{
+		TrocaJanela();
+	}
+#endif
+}
+
+/* Listas de espera */
+
+/* coloca a tarefa atual em espera na lista; a troca de contexto ocorre no fim
+   da regiao critica e a tarefa continua depois de acordada */
+void ListaEsperaBloqueia(lista_espera_t* lista)
+{
+	Assert(PODE_BLOQUEAR());
+	TCB[tarefa_atual].estado = ESPERA;		/* tarefa colocada na fila de espera */
+	TCB[tarefa_atual].espera = lista;
+	*lista |= BIT_ESPERA(tarefa_atual);		/* tarefa colocada na lista de espera */
+	TROCA_CONTEXTO();						/* solicita troca de contexto */
+}
+
+/* tarefa de maior prioridade da lista (0: lista vazia): a do bit mais alto, em
+   tempo constante (no Cortex-M0+, sem instrucao CLZ, a funcao da libgcc usa
+   uma tabela) */
+static uint8_t ListaEsperaMaiorPrioridade(lista_espera_t lista)
+{
+	return lista != 0 ? Prioridades[31 - __builtin_clz(lista)] : 0;
+}
+
+/* acorda a tarefa de maior prioridade da lista e retorna o seu numero (0: lista vazia) */
+uint8_t ListaEsperaAcordaUma(lista_espera_t* lista)
+{
+	uint8_t escolhida = ListaEsperaMaiorPrioridade(*lista);
+	
+	if(escolhida != 0)
+	{
+		*lista &= ~BIT_ESPERA(escolhida);
+		TCB[escolhida].espera = NULL;
+		TCB[escolhida].estado = PRONTA;		/* tarefa colocada na fila de prontas */
+	}
+	return escolhida;
+}
+
+/* acorda todas as tarefas da lista e retorna quantas eram */
+uint8_t ListaEsperaAcordaTodas(lista_espera_t* lista)
+{
+	uint8_t acordadas = 0;
+	
+	while(ListaEsperaAcordaUma(lista) != 0)
+	{
+		acordadas++;
+	}
+	return acordadas;
+}
+
+/* Servicos de semaforos */
+/* unidades que ainda cabem no contador do semaforo */
+#define SEMAFORO_LIVRES(sem)	(((sem)->maximo != 0 ? (sem)->maximo : UINT32_MAX) - (sem)->contador)
+
+/* entrega uma unidade do semaforo: a tarefa de maior prioridade que espera a
+   recebe diretamente; sem tarefas esperando, o contador e incrementado, se
+   ainda nao estiver no maximo */
+static enum status_code SemaforoEntrega(semaforo_t* sem)
+{
+	if(ListaEsperaAcordaUma(&sem->tarefasEsperando) == 0)
+	{
+		if(SEMAFORO_LIVRES(sem) == 0)
+		{
+			return STATUS_ERR_OVERFLOW;
+		}
+		sem->contador++;
+	}
+	return STATUS_OK;
+}
+
+void SemaforoAguarda(semaforo_t* sem)
+{
+	
+	REG_ATOMICA_INICIO();
+	
+	if(sem->contador > 0)
+	{
+		sem->contador--;
+	}else
+	{
+		ListaEsperaBloqueia(&sem->tarefasEsperando);	/* tarefa colocada na espera do semaforo */
+	}
+	
+	REG_ATOMICA_FIM();
+}
+
+/* Obtem o semaforo somente se estiver disponivel, sem bloquear a tarefa */
+enum status_code SemaforoTentaAguardar(semaforo_t* sem)
+{
+	enum status_code resultado = STATUS_BUSY;
+
+	REG_ATOMICA_INICIO();
+
+	if(sem->contador > 0)
+	{
+		sem->contador--;
+		resultado = STATUS_OK;
+	}
+
+	REG_ATOMICA_FIM();
+
+	return resultado;
+}
+
+/* entrega n unidades do semaforo; retorna a primeira tarefa acordada, a de
+   maior prioridade (0: nenhuma) */
+static uint8_t SemaforoEntregaN(semaforo_t* sem, uint32_t n, enum status_code* resultado)
+{
+	uint8_t primeira = 0;
+	uint8_t tarefa;
+	
+	*resultado = STATUS_OK;
+	while(n > 0 && (tarefa = ListaEsperaAcordaUma(&sem->tarefasEsperando)) != 0)
+	{
+		if(primeira == 0)
+		{
+			primeira = tarefa;
+		}
+		n--;
+	}
+	if(n > SEMAFORO_LIVRES(sem))
+	{
+		n = SEMAFORO_LIVRES(sem);
+		*resultado = STATUS_ERR_OVERFLOW;
+	}
+	sem->contador += n;
+	
+	return primeira;
+}
+
+/* Retorna STATUS_ERR_OVERFLOW, sem alterar o semaforo, se o contador ja
+   estiver no maximo */
+enum status_code SemaforoLibera(semaforo_t* sem)
+{
+	enum status_code resultado;
+	
+	REG_ATOMICA_INICIO();
+	
+	/* tem alguma tarefa aguardando ? a de maior prioridade recebe o semaforo */
+	resultado = SemaforoEntrega(sem);
+	if(resultado == STATUS_OK)
+	{
+		TROCA_CONTEXTO();
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return resultado;
+}
+
+/* Libera n unidades do semaforo de uma vez (por exemplo, um lote de buffers
+   devolvido pelo fim de uma transferencia DMA): ate n tarefas que esperam as
+   recebem, em ordem de prioridade, e o restante vai para o contador. Uma unica
+   troca de contexto e solicitada no fim, e somente se alguma tarefa acordou.
+   Como n liberacoes seguidas, as unidades que passariam do maximo sao
+   descartadas e o retorno e STATUS_ERR_OVERFLOW */
+enum status_code SemaforoLiberaN(semaforo_t* sem, uint32_t n)
+{
+	enum status_code resultado;
+	
+	REG_ATOMICA_INICIO();
+	
+	if(SemaforoEntregaN(sem, n, &resultado) != 0)
+	{
+		TROCA_CONTEXTO();
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return resultado;
+}
+
+/* Acorda todas as tarefas que esperam o semaforo, cada uma com uma unidade,
+   com uma unica troca de contexto; o contador nao muda. Retorna quantas
+   tarefas foram acordadas */
+uint8_t SemaforoLiberaTodas(semaforo_t* sem)
+{
+	uint8_t acordadas;
+	
+	REG_ATOMICA_INICIO();
+	
+	acordadas = ListaEsperaAcordaTodas(&sem->tarefasEsperando);
+	if(acordadas > 0)
+	{
+		TROCA_CONTEXTO();
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return acordadas;
+}
+
+/* Servicos para rotinas de interrupcao: em vez de solicitar a troca de
+   contexto a cada chamada, apenas marcam as tarefas como prontas e registram
+   em troca_pendente_isr que alguma foi acordada. A rotina termina com
+   FIM_DE_INTERRUPCAO(), que solicita uma unica troca para todas as tarefas
+   acordadas, inclusive por interrupcoes aninhadas. A preempcao nao e decidida
+   aqui: a tarefa interrompida pode ter acabado de bloquear ou o escalonador
+   pode ter sido interrompido, e so ele decide com o estado atualizado */
+enum status_code SemaforoLiberaISR(semaforo_t* sem)
+{
+	return SemaforoLiberaNISR(sem, 1);
+}
+
+enum status_code SemaforoLiberaNISR(semaforo_t* sem, uint32_t n)
+{
+	enum status_code resultado;
+	uint8_t tarefa;
+	
+	REG_ATOMICA_ISR_INICIO(estado);
+	
+	tarefa = SemaforoEntregaN(sem, n, &resultado);
+	if(tarefa != 0)
+	{
+		troca_pendente_isr = 1;
+	}
+	
+	REG_ATOMICA_ISR_FIM(estado);
+	
+	return resultado;
+}
+
+/* Espera por qualquer um dos semaforos, por ate marcas marcas de tempo (0: sem
+   limite), e obtem somente um deles, cujo indice no vetor e retornado em
+   indice. Filas construidas sobre semaforos (rtos.hpp) tambem podem ser
+   esperadas pelo semaforo dos itens; grupos de eventos nao sao objetos do
+   kernel (os bits de eventos de uma tarefa sao a sua notificacao, esperada
+   com NotificacaoRecebe). A tarefa fica na lista de espera de todos os
+   semaforos; quem libera um deles acorda a tarefa pelo bit da prioridade, em
+   tempo constante, e ela se retira das demais listas ao continuar, em tempo
+   proporcional ao numero de semaforos. Retorna STATUS_ERR_TIMEOUT se o tempo
+   acabar sem que nenhum semaforo seja liberado e STATUS_ERR_INVALID_ARG se um
+   semaforo aparecer mais de uma vez no vetor (a unidade entregue a uma posicao
+   seria devolvida pela outra); a repeticao so e detectada quando a tarefa
+   precisa esperar. Sem unidades disponiveis, retorna STATUS_ERR_DENIED se a
+   tarefa nao puder bloquear (dentro de outra regiao critica ou com o
+   escalonador bloqueado). */
+enum status_code SemaforoAguardaQualquer(semaforo_t* const sems[], uint8_t numero,
+										 tick_t marcas, uint8_t* indice)
+{
+	enum status_code resultado = STATUS_ERR_TIMEOUT;
+	lista_espera_t bit = BIT_ESPERA(tarefa_atual);
+	uint8_t i;
+	
+	if(numero == 0)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+	
+	REG_ATOMICA_INICIO();
+	
+	for(i = 0; i < numero; i++)
+	{
+		if(sems[i]->contador > 0)
+		{
+			sems[i]->contador--;
+			*indice = i;
+			REG_ATOMICA_FIM();
+			return STATUS_OK;
+		}
+	}
+	
+	if(!PODE_BLOQUEAR())
+	{
+		Assert(0);
+		REG_ATOMICA_FIM();
+		return STATUS_ERR_DENIED;
+	}
+	
+	for(i = 0; i < numero; i++)
+	{
+		if(sems[i]->tarefasEsperando & bit)
+		{
+			/* semaforo repetido: a tarefa ja esta na lista dele */
+			while(i > 0)
+			{
+				sems[--i]->tarefasEsperando &= ~bit;
+			}
+			REG_ATOMICA_FIM();
+			return STATUS_ERR_INVALID_ARG;
+		}
+		sems[i]->tarefasEsperando |= bit;
+	}
+	TCB[tarefa_atual].espera_qualquer = sems;
+	TCB[tarefa_atual].espera_numero = numero;
+	TCB[tarefa_atual].tempo_espera = marcas;
+	TCB[tarefa_atual].estado = ESPERA;
+	TrocaContexto();
+	REG_ATOMICA_FIM();		/* a troca de contexto ocorre aqui */
+	
+	REG_ATOMICA_INICIO();
+	
+	/* os semaforos que retiraram a tarefa da lista a entregaram uma unidade:
+	   fica com o primeiro e devolve os demais. O bit e o da prioridade atual,
+	   que pode ter mudado durante a espera */
+	bit = BIT_ESPERA(tarefa_atual);
+	TCB[tarefa_atual].espera_qualquer = NULL;
+	TCB[tarefa_atual].tempo_espera = 0;
+	for(i = 0; i < numero; i++)
+	{
+		if(sems[i]->tarefasEsperando & bit)
+		{
+			sems[i]->tarefasEsperando &= ~bit;
+		}
+		else if(resultado != STATUS_OK)
+		{
+			*indice = i;
+			resultado = STATUS_OK;
+		}
+		else
+		{
+			/* a unidade saiu deste semaforo e sempre cabe de volta */
+			(void)SemaforoEntrega(sems[i]);
+			TrocaContexto();
+		}
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return resultado;
+}
+
+/* Servicos de mutex e variaveis de condicao */
+
+/* heranca de prioridade: a tarefa herda a maior prioridade entre as tarefas
+   que esperam os mutexes que ela ainda tem, e nenhuma tarefa de prioridade
+   intermediaria a preempta. Recalculada a cada mudanca, de modo que liberar um
+   mutex aninhado nao perde a heranca recebida por outro. A heranca segue a
+   cadeia de donas (transitiva): uma dona que espera outro mutex passa a
+   prioridade herdada a dona dele. A cadeia tem no maximo numero_tarefas
+   elos, mesmo em um impasse (ciclo de esperas) */
+static void MutexRecalculaHeranca(uint8_t tarefa)
+{
+#if cfg_LIMIAR_PREEMPCAO
+	uint8_t elos;
+	
+	for(elos = numero_tarefas; tarefa != 0 && elos > 0; elos--)
+	{
+		mutex_t *mutex;
+		prioridade_t heranca = 0;
+		
+		for(mutex = TCB[tarefa].mutexes; mutex != NULL; mutex = mutex->proximo)
+		{
+			lista_espera_t lista = mutex->tarefasEsperando;
+			
+			/* cada tarefa que espera conta com a sua prioridade ou com a que herdou */
+			while(lista != 0)
+			{
+				uint8_t esperando = ListaEsperaMaiorPrioridade(lista);
+				prioridade_t prioridade = TCB[esperando].prioridade;
+				
+				if(TCB[esperando].heranca > prioridade)
+				{
+					prioridade = TCB[esperando].heranca;
+				}
+				if(prioridade > heranca)
+				{
+					heranca = prioridade;
+				}
+				lista &= ~BIT_ESPERA(esperando);
+			}
+		}
+		
+		if(heranca == TCB[tarefa].heranca)
+		{
+			break;		/* as donas seguintes nao mudam */
+		}
+		TCB[tarefa].heranca = heranca;
+		tarefa = TCB[tarefa].aguarda_mutex != NULL ? TCB[tarefa].aguarda_mutex->dona : 0;
+	}
+#else
+	(void)tarefa;
+#endif
+}
+
+/* entrega o mutex livre a tarefa */
+static void MutexEntrega(mutex_t* mutex, uint8_t tarefa)
+{
+	mutex->dona = tarefa;
+	mutex->proximo = TCB[tarefa].mutexes;
+	TCB[tarefa].mutexes = mutex;
+#if cfg_LIMIAR_PREEMPCAO
+	TCB[tarefa].aguarda_mutex = NULL;
+#endif
+	MutexRecalculaHeranca(tarefa);
+}
+
+enum status_code MutexTrava(mutex_t* mutex)
+{
+	enum status_code resultado = STATUS_OK;
+	
+	REG_ATOMICA_INICIO();
+	
+	if(mutex->dona == 0)
+	{
+		MutexEntrega(mutex, tarefa_atual);
+	}
+	else if(mutex->dona == tarefa_atual || !PODE_BLOQUEAR())
+	{
+		resultado = STATUS_ERR_DENIED;		/* nao e recursivo e nao espera em regiao critica */
+	}
+	else
+	{
+		/* espera; MutexDestrava() entrega o mutex a esta tarefa */
+		ListaEsperaBloqueia(&mutex->tarefasEsperando);
+#if cfg_LIMIAR_PREEMPCAO
+		TCB[tarefa_atual].aguarda_mutex = mutex;
+#endif
+		MutexRecalculaHeranca(mutex->dona);
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return resultado;
+}
+
+enum status_code MutexTentaTravar(mutex_t* mutex)
+{
+	enum status_code resultado = STATUS_BUSY;
+	
+	REG_ATOMICA_INICIO();
+	
+	if(mutex->dona == 0)
+	{
+		MutexEntrega(mutex, tarefa_atual);
+		resultado = STATUS_OK;
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return resultado;
+}
+
+/* retira o mutex da lista da dona, recalcula a heranca dela e entrega o mutex
+   a tarefa de maior prioridade que espera */
+static void MutexRepassa(mutex_t* mutex)
+{
+	mutex_t **anterior = &TCB[mutex->dona].mutexes;
+	uint8_t proxima;
+	
+	while(*anterior != mutex)
+	{
+		anterior = &(*anterior)->proximo;
+	}
+	*anterior = mutex->proximo;
+	mutex->proximo = NULL;
+	MutexRecalculaHeranca(mutex->dona);
+	mutex->dona = 0;
+	
+	proxima = ListaEsperaAcordaUma(&mutex->tarefasEsperando);
+	if(proxima != 0)
+	{
+		MutexEntrega(mutex, proxima);
+	}
+}
+
+enum status_code MutexDestrava(mutex_t* mutex)
+{
+	REG_ATOMICA_INICIO();
+	
+	if(mutex->dona != tarefa_atual)
+	{
+		REG_ATOMICA_FIM();
+		return STATUS_ERR_DENIED;
+	}
+	
+	MutexRepassa(mutex);
+	TROCA_CONTEXTO();
+	
+	REG_ATOMICA_FIM();
+	
+	return STATUS_OK;
+}
+
+/* Libera o mutex e espera a condicao de forma atomica; retorna com o mutex
+   obtido novamente. A condicao deve ser verificada de novo pela tarefa, em um
+   laco, pois pode ter mudado antes de a tarefa obter o mutex */
+enum status_code CondicaoAguarda(condicao_t* cond, mutex_t* mutex)
+{
+	REG_ATOMICA_INICIO();
+	
+	if(mutex->dona != tarefa_atual || !PODE_BLOQUEAR() ||
+	   (cond->tarefasEsperando != 0 && cond->mutex != mutex))
+	{
+		REG_ATOMICA_FIM();
+		return STATUS_ERR_DENIED;
+	}
+	
+	cond->mutex = mutex;
+	MutexRepassa(mutex);
+	ListaEsperaBloqueia(&cond->tarefasEsperando);
+	
+	REG_ATOMICA_FIM();
+	
+	return STATUS_OK;
+}
+
+/* passa a tarefa da condicao para o mutex: recebe-o se estiver livre ou
+   continua em espera, agora na fila do mutex */
+static void CondicaoTransfere(condicao_t* cond, uint8_t tarefa)
+{
+	mutex_t *mutex = cond->mutex;
+	
+	cond->tarefasEsperando &= ~BIT_ESPERA(tarefa);
+	if(mutex->dona == 0)
+	{
+		TCB[tarefa].espera = NULL;
+		TCB[tarefa].estado = PRONTA;
+		MutexEntrega(mutex, tarefa);
+	}
+	else
+	{
+		mutex->tarefasEsperando |= BIT_ESPERA(tarefa);
+		TCB[tarefa].espera = &mutex->tarefasEsperando;
+#if cfg_LIMIAR_PREEMPCAO
+		TCB[tarefa].aguarda_mutex = mutex;
+#endif
+		MutexRecalculaHeranca(mutex->dona);
+	}
+}
+
+/* acorda a tarefa de maior prioridade que espera a condicao */
+void CondicaoSinaliza(condicao_t* cond)
+{
+	uint8_t tarefa;
+	
+	REG_ATOMICA_INICIO();
+	
+	tarefa = ListaEsperaMaiorPrioridade(cond->tarefasEsperando);
+	if(tarefa != 0)
+	{
+		CondicaoTransfere(cond, tarefa);
+		TROCA_CONTEXTO();
+	}
+	
+	REG_ATOMICA_FIM();
+}
+
+/* acorda todas as tarefas que esperam a condicao; elas obtem o mutex uma de
+   cada vez, em ordem de prioridade */
+void CondicaoSinalizaTodas(condicao_t* cond)
+{
+	uint8_t tarefa;
+	
+	REG_ATOMICA_INICIO();
+	
+	if(cond->tarefasEsperando != 0)
+	{
+		while((tarefa = ListaEsperaMaiorPrioridade(cond->tarefasEsperando)) != 0)
+		{
+			CondicaoTransfere(cond, tarefa);
+		}
+		TROCA_CONTEXTO();
+	}
+	
+	REG_ATOMICA_FIM();
+}
+
+/* Servicos da trava de leitura e escrita. A trava e repassada diretamente as
+   tarefas acordadas, que continuam com ela ja obtida */
+void TravaLeituraObtem(trava_le_t* trava)
+{
+	REG_ATOMICA_INICIO();
+	
+	if(trava->escritor == 0 && trava->escritoresEsperando == 0)
+	{
+		trava->leitores++;
+		TRAVAS_CONTA(tarefa_atual, 1);
+	}
+	else
+	{
+		ListaEsperaBloqueia(&trava->leitoresEsperando);
+	}
+	
+	REG_ATOMICA_FIM();
+}
+
+enum status_code TravaLeituraLibera(trava_le_t* trava)
+{
+	enum status_code resultado = STATUS_OK;
+	
+	REG_ATOMICA_INICIO();
+	
+	if(trava->leitores == 0)
+	{
+		resultado = STATUS_ERR_DENIED;
+	}
+	else
+	{
+		TRAVAS_CONTA(tarefa_atual, -1);
+		if(--trava->leitores == 0)
+		{
+			/* ultimo leitor: repassa a trava ao escritor de maior prioridade */
+			trava->escritor = ListaEsperaAcordaUma(&trava->escritoresEsperando);
+			if(trava->escritor != 0)
+			{
+				TRAVAS_CONTA(trava->escritor, 1);
+				TROCA_CONTEXTO();
+			}
+		}
+	}
+	
+	REG_ATOMICA_FIM();
+	
+	return resultado;
+}
+
+void TravaEscritaObtem(trava_le_t* trava)
+{
+	REG_ATOMICA_INICIO();
+	
+	if(trava->escritor == 0 && trava->leitores == 0)
+	{
+		trava->escritor = tarefa_atual;
+		TRAVAS_CONTA(tarefa_atual, 1);
+	}
+	else
+	{
+		ListaEsperaBloqueia(&trava->escritoresEsperando);
+	}
+	
+	REG_ATOMICA_FIM();
+}
+
+enum status_code TravaEscritaLibera(trava_le_t* trava)
+{
+	uint8_t tarefa;
+	
+	REG_ATOMICA_INICIO();
+	
+	if(trava->escritor != tarefa_atual)
+	{
+		REG_ATOMICA_FIM();
+		return STATUS_ERR_DENIED;
+	}
+	
+	/* leitores que esperavam entram antes do proximo escritor */
+	TRAVAS_CONTA(tarefa_atual, -1);
+	trava->escritor = 0;
+	while((tarefa = ListaEsperaAcordaUma(&trava->leitoresEsperando)) != 0)
+	{
+		trava->leitores++;
+		TRAVAS_CONTA(tarefa, 1);
+	}
+	if(trava->leitores == 0)
+	{
+		trava->escritor = ListaEsperaAcordaUma(&trava->escritoresEsperando);
+		if(trava->escritor != 0)
+		{
+			TRAVAS_CONTA(trava->escritor, 1);
+		}
+	}
+	TROCA_CONTEXTO();
+	
+	REG_ATOMICA_FIM();
+	
+	return STATUS_OK;
+}
@@ -11,14 +11,22 @@
 #include "stdint.h"
 #include "cpu-port.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /******************************************************************/
 /* macros de configuracao */
 
 /* numero de tarefas */
+#ifndef NUMERO_DE_TAREFAS
 #define NUMERO_DE_TAREFAS	3
+#endif
 
 /* numero de prioridades/tarefas */
+#ifndef PRIORIDADE_MAXIMA
 #define PRIORIDADE_MAXIMA   4
+#endif
 
 /* frequencia de clock da CPU */
 #define cfg_CPU_CLOCK_HZ 	48000000
@@ -26,11 +34,138 @@
 /* frequencia da marca de tempo do sistema multitarefas */
 #define cfg_MARCA_TEMPO_HZ  1000
 
+/* troca de contexto solicitada a cada marca de tempo (preempcao na marca).
+   Com 0 o sistema e cooperativo na marca: uma tarefa acordada pelo tempo
+   (TarefaEspera) so executa quando a tarefa atual chama um servico do sistema
+   ou uma interrupcao solicita a troca. As liberacoes de semaforos,
+   notificacoes e FIM_DE_INTERRUPCAO() preemptam nos dois modos. A analise
+   (ferramentas/analise_rta) e o simulador assumem o modo cooperativo, como
+   neste padrao; com 1, usar a opcao -P nos dois */
+#ifndef cfg_PREEMPCAO_NA_MARCA
+#define cfg_PREEMPCAO_NA_MARCA	0
+#endif
+
+/* medicao dos custos da marca de tempo e da troca de contexto (em ciclos de clock),
+   usados pela analise de escalonabilidade (rtos/ferramentas) */
+#ifndef cfg_MEDE_CUSTOS
+#define cfg_MEDE_CUSTOS		0
+#endif
+
+/* medicao do maior tempo com interrupcoes desabilitadas (em ciclos de clock) e
+   do local onde ocorreu, que limita a latencia de interrupcao no pior caso */
+#ifndef cfg_MEDE_REGIAO_CRITICA
+#define cfg_MEDE_REGIAO_CRITICA	0
+#endif
+
+/* tarefa ociosa em modo de baixo consumo, usando o driver power do ASF */
+#ifndef cfg_OCIOSA_BAIXO_CONSUMO
+#define cfg_OCIOSA_BAIXO_CONSUMO	1
+#endif
+
+/* marcas de tempo ate o proximo despertar a partir das quais a tarefa ociosa
+   usa os niveis de sono IDLE 1 e IDLE 2; abaixo disso usa IDLE 0. Os niveis
+   escolhidos devem manter o SysTick (marca de tempo) em funcionamento.
+   IDLE 2 (0 desabilita) so deve ser habilitado depois de verificar na placa
+   que a marca de tempo continua a acordar o processador nesse nivel */
+#ifndef cfg_OCIOSA_MARCAS_IDLE_1
+#define cfg_OCIOSA_MARCAS_IDLE_1	2
+#endif
+#ifndef cfg_OCIOSA_MARCAS_IDLE_2
+#define cfg_OCIOSA_MARCAS_IDLE_2	0
+#endif
+
+/* permite STANDBY quando nenhuma tarefa espera por tempo (o SysTick para e
+   somente interrupcoes externas acordam o processador) */
+#define cfg_OCIOSA_PERMITE_STANDBY	0
+
+/* palavras de guarda no fundo de cada pilha, verificadas a cada troca de contexto
+   (0 desabilita). O custo por troca aparece em custo_max_troca_contexto */
+#ifndef cfg_PILHA_PALAVRAS_GUARDA
+#define cfg_PILHA_PALAVRAS_GUARDA	2
+#endif
+
+/* acao ao detectar estouro de pilha */
+#define PILHA_ESTOURO_GANCHO		1	/* chama PilhaEstouroGancho() */
+#define PILHA_ESTOURO_ELIMINA		2	/* a tarefa nunca mais e escalonada, sai das listas de espera e libera mutexes e recursos */
+#define PILHA_ESTOURO_REINICIA		3	/* reinicia o processador */
+
+#ifndef cfg_PILHA_ESTOURO_ACAO
+#define cfg_PILHA_ESTOURO_ACAO		PILHA_ESTOURO_GANCHO
+#endif
+
+/* valor das palavras de guarda */
+#define PILHA_PADRAO_GUARDA			0xC0FFEE55UL
+
+/* padrao da pilha ainda nao usada, para a medicao da pilha livre (cfg_ESTATISTICAS) */
+#define PILHA_PADRAO_LIVRE			0xA5A5A5A5UL
+
+/* limiar de preempcao por tarefa (TarefaDefineLimiar): uma tarefa ja iniciada
+   so e preemptada por tarefas com prioridade maior que o seu limiar. Com 0, a
+   preempcao compara apenas as prioridades e nao ha heranca de prioridade */
+#ifndef cfg_LIMIAR_PREEMPCAO
+#define cfg_LIMIAR_PREEMPCAO		1
+#endif
+
+/* numero de particoes de tempo (0 desabilita). Com particoes, uma tabela de
+   janelas (ParticoesInicia) repetida a cada quadro maior define qual particao
+   esta ativa em cada marca de tempo; dentro da janela, o escalonador por
+   prioridades escolhe entre as tarefas da particao ativa e as da particao 0 */
+#ifndef cfg_PARTICOES
+#define cfg_PARTICOES				0
+#endif
+
+/* numero de servidores esporadicos (0 desabilita): tarefas com orcamento de
+   processador por periodo de reposicao (TarefaDefineServidor), contabilizado em
+   marcas de tempo. Cada servidor guarda ate cfg_SERVIDOR_REPOSICOES reposicoes
+   pendentes; alem disso, a reposicao e somada a ultima (mais tarde) */
+#ifndef cfg_SERVIDORES
+#define cfg_SERVIDORES				0
+#endif
+
+#ifndef cfg_SERVIDOR_REPOSICOES
+#define cfg_SERVIDOR_REPOSICOES		4
+#endif
+
+/* notificacoes diretas para tarefas (TarefaNotifica/NotificacaoRecebe): um
+   valor de 32 bits no TCB usado no lugar de um semaforo quando um unico
+   emissor sinaliza uma tarefa especifica */
+#ifndef cfg_NOTIFICACOES
+#define cfg_NOTIFICACOES			1
+#endif
+
+/* estatisticas do kernel para inspecao em execucao (shell.h): marcas de tempo
+   de processador por tarefa (amostradas na marca de tempo), pilha nunca usada,
+   trocas de contexto, prazos perdidos e ate cfg_ESTATISTICAS_SEMAFOROS
+   semaforos registrados com nome */
+#ifndef cfg_ESTATISTICAS
+#define cfg_ESTATISTICAS			0
+#endif
+
+#ifndef cfg_ESTATISTICAS_SEMAFOROS
+#define cfg_ESTATISTICAS_SEMAFOROS	8
+#endif
+
+/* tarefas declaradas em uma tabela estatica (DEFINE_TABELA_DE_TAREFAS) em vez de
+   criadas com CriaTarefa() */
+#ifndef cfg_TABELA_ESTATICA
+#define cfg_TABELA_ESTATICA			0
+#endif
+
 typedef  void (*tarefa_t)(void);
 typedef enum {PRONTA, ESPERA} estado_tarefa_t;
 typedef uint8_t	  prioridade_t;
 typedef uint16_t  tick_t;
 
+typedef struct mutex mutex_t;
+typedef struct semaforo semaforo_t;
+typedef struct recurso recurso_t;
+
+/* lista de espera dos objetos de sincronizacao: um bit por prioridade (bit n
+   para a tarefa de prioridade n, unica). A tarefa de maior prioridade da
+   lista, a primeira a ser acordada, e a do bit mais alto, encontrada em tempo
+   constante, sem percorrer as tarefas */
+typedef uint32_t  lista_espera_t;
+
 /**
 * \struct tcb_t
 * Estrutura de controle de tarefas
@@ -43,6 +178,37 @@ typedef struct
 	estado_tarefa_t estado;
 	prioridade_t 	prioridade;
 	uint16_t		tempo_espera;
+	stackptr_t		base_pilha;		/* inicio (fundo) da pilha, onde ficam as palavras de guarda */
+	prioridade_t	limiar;			/* limiar de preempcao (>= prioridade), elevado pelos recursos */
+	uint8_t			iniciada;		/* executou e nao bloqueou desde entao */
+	mutex_t			*mutexes;		/* mutexes obtidos pela tarefa (lista encadeada) */
+	lista_espera_t	*espera;		/* lista de espera em que a tarefa esta bloqueada (NULL: nenhuma) */
+	semaforo_t * const *espera_qualquer;	/* semaforos de SemaforoAguardaQualquer() (NULL: nenhum) */
+	uint8_t			espera_numero;
+#if cfg_LIMIAR_PREEMPCAO
+	prioridade_t	limiar_base;	/* limiar sem recursos (TarefaDefineLimiar) */
+	recurso_t		*recursos;		/* recursos obtidos, o ultimo primeiro */
+	prioridade_t	heranca;		/* maior prioridade que espera um mutex da tarefa */
+	mutex_t			*aguarda_mutex;	/* mutex que a tarefa espera (NULL: nenhum) */
+#endif
+#if cfg_PARTICOES
+	uint8_t			particao;		/* 0: executa em todas as janelas */
+	uint8_t			aguarda_janela;	/* espera o inicio da proxima janela da particao */
+#endif
+#if cfg_SERVIDORES
+	uint8_t			servidor;		/* servidor esporadico + 1 (0: sem orcamento) */
+#endif
+#if cfg_PILHA_ESTOURO_ACAO == PILHA_ESTOURO_ELIMINA
+	uint8_t			travas;			/* travas de leitura e escrita obtidas */
+#endif
+#if cfg_NOTIFICACOES
+	uint32_t		notificacao;	/* valor da notificacao */
+	uint8_t			aguarda_notificacao;
+#endif
+#if cfg_ESTATISTICAS
+	uint32_t		marcas_cpu;		/* marcas de tempo em que a tarefa executava */
+	uint16_t		prazos_perdidos;
+#endif
 }tcb_t;
 
 extern  uint8_t		tarefa_atual;
@@ -51,16 +217,216 @@ extern  tcb_t		TCB[NUMERO_DE_TAREFAS+1];
 extern  stackptr_t	ponteiro_de_pilha;
 extern  prioridade_t Prioridades[PRIORIDADE_MAXIMA+1];
 
+/* troca de contexto pedida pelos servicos ...ISR(), feita uma unica vez por
+   FIM_DE_INTERRUPCAO(), no fim da rotina de interrupcao */
+extern  volatile uint8_t troca_pendente_isr;
+
+#define FIM_DE_INTERRUPCAO()	do { if(troca_pendente_isr) { troca_pendente_isr = 0; TROCA_CONTEXTO(); } } while(0)
+
+#if cfg_MEDE_CUSTOS
+extern  uint32_t	custo_max_marca_tempo;		/* maior custo medido de ExecutaMarcaDeTempo() */
+extern  uint32_t	custo_max_troca_contexto;	/* maior custo medido de TrocaContextoDasTarefas() */
+#endif
+
+#if cfg_MEDE_REGIAO_CRITICA
+extern  uint32_t	regiao_critica_max_ciclos;	/* maior tempo com interrupcoes desabilitadas */
+extern  const void	*regiao_critica_max_origem;	/* endereco de retorno de quem abriu essa regiao */
+#endif
+
+#if cfg_ESTATISTICAS
+/**
+* \struct estatisticas_kernel_t
+* Contadores do kernel desde o inicio ou desde EstatisticasZera()
+*/
+
+typedef struct
+{
+	uint32_t	marcas;				/* marcas de tempo (base do uso do processador) */
+	uint32_t	trocas_contexto;	/* trocas efetivas de tarefa */
+	uint32_t	prazos_perdidos;	/* soma dos prazos perdidos das tarefas */
+} estatisticas_kernel_t;
+
+extern  estatisticas_kernel_t	EstatisticasKernel;
+#endif
+
+#if cfg_TABELA_ESTATICA
+/**
+* \struct tarefa_estatica_t
+* Descricao de uma tarefa da tabela estatica, mantida na memoria flash
+*/
+
+typedef struct
+{
+	tarefa_t		funcao;
+	const char		*nome;
+	stackptr_t		pilha;
+	uint16_t		tamanho;
+	prioridade_t	prioridade;
+} tarefa_estatica_t;
+
+extern  const tarefa_estatica_t	TabelaDeTarefas[];
+extern  const uint8_t			NumeroTarefasEstaticas;
+
+/* A aplicacao descreve as tarefas com uma lista X(funcao, nome, tamanho_pilha, prioridade),
+   incluindo a tarefa ociosa com prioridade 0, e chama DEFINE_TABELA_DE_TAREFAS(lista)
+   uma unica vez. A macro define em tempo de compilacao:
+   - as pilhas das tarefas (PILHA_funcao);
+   - os numeros das tarefas ID_funcao, na ordem da lista, para os servicos do kernel;
+   - a tabela TabelaDeTarefas, na memoria flash;
+   - o vetor Prioridades ja preenchido, sem codigo de inicializacao.
+   Prioridades devem ser numeros literais: prioridades repetidas geram erro de
+   compilacao (enumerador PRIORIDADE_REPETIDA_n redeclarado). */
+#define TABELA_X_PILHA(f, n, t, p)		static uint32_t PILHA_##f[t];
+#define TABELA_X_ID(f, n, t, p)			ID_##f,
+#define TABELA_X_PRIORIDADE(f, n, t, p)	PRIORIDADE_REPETIDA_##p,
+#define TABELA_X_VERIFICA(f, n, t, p)	_Static_assert((p) <= PRIORIDADE_MAXIMA, #f ": prioridade maior que PRIORIDADE_MAXIMA"); \
+										_Static_assert((t) >= TAM_MINIMO_PILHA + cfg_PILHA_PALAVRAS_GUARDA, #f ": pilha menor que o minimo");
+#define TABELA_X_TAREFA(f, n, t, p)		{ f, n, PILHA_##f, t, p },
+#define TABELA_X_MAPA(f, n, t, p)		[p] = ID_##f,
+
+#define DEFINE_TABELA_DE_TAREFAS(LISTA)												\
+	LISTA(TABELA_X_PILHA)															\
+	enum { ID_NENHUMA_TAREFA = 0, LISTA(TABELA_X_ID) };								\
+	enum { LISTA(TABELA_X_PRIORIDADE) };											\
+	LISTA(TABELA_X_VERIFICA)														\
+	const tarefa_estatica_t TabelaDeTarefas[] = { LISTA(TABELA_X_TAREFA) };			\
+	const uint8_t NumeroTarefasEstaticas =											\
+		sizeof(TabelaDeTarefas) / sizeof(TabelaDeTarefas[0]);						\
+	_Static_assert(sizeof(TabelaDeTarefas) / sizeof(TabelaDeTarefas[0]) <= NUMERO_DE_TAREFAS, \
+				   "mais tarefas que NUMERO_DE_TAREFAS");							\
+	prioridade_t Prioridades[PRIORIDADE_MAXIMA+1] = { LISTA(TABELA_X_MAPA) };
+
+void IniciaTarefasEstaticas(void);
+#endif
+
+/* valor retornado quando nenhuma tarefa espera por tempo */
+#define MARCAS_INDEFINIDAS	((tick_t)0xFFFF)
+
+#if cfg_OCIOSA_BAIXO_CONSUMO
+/* estatisticas da tarefa ociosa por nivel de sono (IDLE 0, 1, 2 e STANDBY) */
+#define NUMERO_MODOS_SONO	4
+
+typedef struct
+{
+	uint32_t	entradas;		/* vezes em que o nivel foi usado */
+	uint64_t	ciclos;			/* tempo total no nivel, em ciclos de clock */
+} estatistica_sono_t;
+
+extern  estatistica_sono_t	EstatisticasSono[NUMERO_MODOS_SONO];
+#endif
+
+#if cfg_PARTICOES
+/**
+* \struct janela_particao_t
+* Janela da tabela de particoes: a particao fica ativa durante marcas marcas
+* de tempo. A sequencia de janelas forma o quadro maior, repetido ciclicamente.
+* Janelas da particao 0 executam somente as tarefas da particao 0.
+*/
+
+typedef struct
+{
+	uint8_t		particao;
+	tick_t		marcas;
+} janela_particao_t;
+
+/* janelas encerradas com tarefas da particao ainda prontas, por particao */
+extern  uint16_t	ParticaoEstouros[cfg_PARTICOES+1];
+#endif
+
+#if cfg_LIMIAR_PREEMPCAO
+/**
+* \struct recurso_t
+* Recurso com teto de prioridade imediato (como os recursos do OSEK): a tarefa
+* que o obtem passa a ter limiar de preempcao igual ao teto, a maior prioridade
+* entre as tarefas que usam o recurso. Nenhuma delas a preempta ate a
+* liberacao, logo nao ha fila de espera. Recursos sao liberados na ordem
+* inversa da obtencao e a tarefa nao deve esperar enquanto os detem.
+*/
+
+struct recurso
+{
+	prioridade_t	teto;
+	uint8_t			tarefa;				/* tarefa que detem o recurso (0: livre) */
+	recurso_t		*anterior;			/* recurso obtido antes pela mesma tarefa */
+};
+
+/* recurso_t recurso = RECURSO_INICIAL(teto); */
+#define RECURSO_INICIAL(teto)		{ (teto), 0, NULL }
+#endif
+
+#if cfg_NOTIFICACOES
+/* acao de TarefaNotifica() sobre o valor da notificacao */
+typedef enum
+{
+	NOTIFICA_DA,				/* incrementa (semaforo contador/binario) */
+	NOTIFICA_BITS,				/* OU com o valor (grupo de eventos) */
+	NOTIFICA_SOBRESCREVE		/* substitui o valor (caixa postal de um elemento) */
+} acao_notificacao_t;
+#endif
+
 /**
 * \struct semaforo_t
-* Estrutura de controle do semaforo
+* Estrutura de controle do semaforo. O maximo (0: UINT32_MAX) limita o
+* contador; a liberacao que passaria dele e recusada com STATUS_ERR_OVERFLOW.
+* Iniciadores {inicial, 0} continuam validos, sem maximo.
+*/
+
+struct semaforo
+{
+	uint32_t    contador;            ///< Contador do semaforo
+	lista_espera_t tarefasEsperando;    ///< Tarefas esperando
+	uint32_t    maximo;              ///< Maximo do contador (0: sem limite)
+};
+
+/* semaforo_t sem = SEMAFORO_INICIAL(inicial, maximo); */
+#define SEMAFORO_INICIAL(inicial, maximo)	{ (inicial), 0, (maximo) }
+
+/**
+* \struct mutex_t
+* Mutex com dona e fila de espera, repassado diretamente a tarefa de maior
+* prioridade que espera. Com limiar de preempcao, a dona herda a maior
+* prioridade entre as tarefas que esperam qualquer um dos mutexes que ela
+* tem, recalculada a cada liberacao, inclusive depois de a dona bloquear. A
+* heranca e transitiva: se a dona espera outro mutex, a dona dele tambem a
+* herda. Sem limiar (cfg_LIMIAR_PREEMPCAO 0) nao ha heranca de prioridade.
+* Nao e recursivo. Inicializar com {0}.
+*/
+
+struct mutex
+{
+	uint8_t			dona;				/* tarefa com o mutex (0: livre) */
+	mutex_t			*proximo;			/* proximo mutex da mesma dona */
+	lista_espera_t	tarefasEsperando;
+};
+
+/**
+* \struct condicao_t
+* Variavel de condicao associada a um mutex. Quem espera libera o mutex e
+* bloqueia de forma atomica; a tarefa sinalizada passa a esperar o mutex e
+* continua com ele obtido. Inicializar com {0}.
+*/
+
+typedef struct
+{
+	mutex_t			*mutex;				/* mutex das tarefas que esperam */
+	lista_espera_t	tarefasEsperando;
+} condicao_t;
+
+/**
+* \struct trava_le_t
+* Trava de leitura e escrita: varios leitores ou um escritor. Com escritores
+* esperando, novos leitores esperam (preferencia para a escrita); ao fim de
+* cada escrita, os leitores que esperavam entram antes do proximo escritor,
+* logo nenhum dos lados espera indefinidamente. Inicializar com {0}.
 */
 
-typedef struct 
+typedef struct
 {
-	uint8_t     contador;            ///< Contador do semaforo
-	uint8_t 	tarefaEsperando;        ///< Tarefa esperando
-} semaforo_t;
+	uint8_t			leitores;				/* leitores com a trava */
+	uint8_t			escritor;				/* tarefa com a trava para escrita (0: nenhuma) */
+	lista_espera_t	leitoresEsperando;
+	lista_espera_t	escritoresEsperando;
+} trava_le_t;
 
 
 void tarefa_ociosa(void);
@@ -73,10 +439,88 @@ void IniciaMultitarefas(void);
 void ConfiguraMarcaTempo(void);
 void ExecutaMarcaDeTempo(void);
 
+tick_t MarcasAteProximoDespertar(void);
+tick_t MarcasDeTempo(void);
+#if cfg_OCIOSA_BAIXO_CONSUMO
+void OciosaDorme(tick_t marcas_livres);
+#endif
+
+void PilhaEstouroGancho(uint8_t id_tarefa);
+
 void TarefaSuspende(uint8_t id_tarefa);
 void TarefaContinua(uint8_t id_tarefa);
 void TarefaEspera(tick_t qtas_marcas);		
+enum status_code TarefaMudaPrioridade(uint8_t id_tarefa, prioridade_t nova_prioridade);
+#if cfg_LIMIAR_PREEMPCAO
+enum status_code TarefaDefineLimiar(uint8_t id_tarefa, prioridade_t limiar);
+#endif
+
+#if cfg_PARTICOES
+enum status_code ParticoesInicia(const janela_particao_t *tabela, uint8_t numero);
+enum status_code TarefaDefineParticao(uint8_t id_tarefa, uint8_t particao);
+void ParticaoAguardaJanela(void);
+uint8_t ParticaoAtiva(void);
+void ParticaoEstouroGancho(uint8_t particao);
+#endif
+
+#if cfg_SERVIDORES
+enum status_code TarefaDefineServidor(uint8_t id_tarefa, tick_t orcamento, tick_t periodo);
+tick_t ServidorOrcamento(uint8_t id_tarefa);
+uint16_t ServidorEsgotamentos(uint8_t id_tarefa);
+#endif
+
+#if cfg_LIMIAR_PREEMPCAO
+enum status_code RecursoObtem(recurso_t* recurso);
+enum status_code RecursoLibera(recurso_t* recurso);
+#endif
+
+#if cfg_NOTIFICACOES
+enum status_code TarefaNotifica(uint8_t id_tarefa, uint32_t valor, acao_notificacao_t acao);
+enum status_code TarefaNotificaISR(uint8_t id_tarefa, uint32_t valor, acao_notificacao_t acao);
+uint32_t NotificacaoRecebe(uint8_t zera);
+#endif
+
+void EscalonadorBloqueia(void);
+void EscalonadorLibera(void);
+
+#if cfg_ESTATISTICAS
+uint16_t PilhaMinimoLivre(uint8_t id_tarefa);
+void TarefaPrazoPerdido(uint8_t id_tarefa);
+void EstatisticasZera(void);
+enum status_code SemaforoRegistra(semaforo_t* sem, const char* nome);
+semaforo_t* SemaforoRegistrado(uint8_t indice, const char** nome);
+#endif
+
+/* servicos para objetos de sincronizacao, chamados em regiao critica */
+void ListaEsperaBloqueia(lista_espera_t* lista);
+uint8_t ListaEsperaAcordaUma(lista_espera_t* lista);
+uint8_t ListaEsperaAcordaTodas(lista_espera_t* lista);
 
 void SemaforoAguarda(semaforo_t* sem);
-void SemaforoLibera(semaforo_t* sem);
+enum status_code SemaforoTentaAguardar(semaforo_t* sem);
+enum status_code SemaforoLibera(semaforo_t* sem);
+enum status_code SemaforoLiberaN(semaforo_t* sem, uint32_t n);
+uint8_t SemaforoLiberaTodas(semaforo_t* sem);
+enum status_code SemaforoLiberaISR(semaforo_t* sem);
+enum status_code SemaforoLiberaNISR(semaforo_t* sem, uint32_t n);
+enum status_code SemaforoAguardaQualquer(semaforo_t* const sems[], uint8_t numero,
+										 tick_t marcas, uint8_t* indice);
+
+enum status_code MutexTrava(mutex_t* mutex);
+enum status_code MutexTentaTravar(mutex_t* mutex);
+enum status_code MutexDestrava(mutex_t* mutex);
+
+enum status_code CondicaoAguarda(condicao_t* cond, mutex_t* mutex);
+void CondicaoSinaliza(condicao_t* cond);
+void CondicaoSinalizaTodas(condicao_t* cond);
+
+void TravaLeituraObtem(trava_le_t* trava);
+enum status_code TravaLeituraLibera(trava_le_t* trava);
+void TravaEscritaObtem(trava_le_t* trava);
+enum status_code TravaEscritaLibera(trava_le_t* trava);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* MULTITAREFAS_H_ */
\ No newline at end of file
@@ -0,0 +1,319 @@
+/*
+ * rtos.hpp
+ *
+ * Camada C++ sobre a API do sistema multitarefas (rtos.h), somente cabecalho.
+ *
+ * Todas as funcoes sao inline e apenas repassam os argumentos aos servicos em C;
+ * a alocacao (pilhas, semaforos e filas) e estatica, feita pelos templates, e os
+ * construtores sao constexpr, de modo que objetos globais sao iniciados em tempo
+ * de compilacao, sem codigo de inicializacao. Nao usa excecoes, RTTI nem memoria
+ * dinamica. A comparacao do codigo gerado com o equivalente em C esta em
+ * rtos/ferramentas (make compara_tamanho); ate agora so foi feita com o
+ * compilador do computador, nao com o do processador.
+ *
+ * A tabela estatica de tarefas (DEFINE_TABELA_DE_TAREFAS) usa recursos de C99
+ * e deve ficar em um arquivo .c.
+ */
+
+#ifndef MULTITAREFAS_HPP_
+#define MULTITAREFAS_HPP_
+
+#include "rtos.h"
+
+namespace rtos
+{
+
+/**
+* \class RegiaoCritica
+* Regiao critica (REG_ATOMICA_INICIO/REG_ATOMICA_FIM) com o tempo de vida do objeto
+*/
+
+class RegiaoCritica
+{
+public:
+	RegiaoCritica() { REG_ATOMICA_INICIO(); }
+	~RegiaoCritica() { REG_ATOMICA_FIM(); }
+
+	RegiaoCritica(const RegiaoCritica &) = delete;
+	RegiaoCritica &operator=(const RegiaoCritica &) = delete;
+};
+
+/**
+* \class EscalonadorBloqueado
+* Bloqueio do escalonador (EscalonadorBloqueia/EscalonadorLibera) com o tempo
+* de vida do objeto; as interrupcoes continuam habilitadas
+*/
+
+class EscalonadorBloqueado
+{
+public:
+	EscalonadorBloqueado() { EscalonadorBloqueia(); }
+	~EscalonadorBloqueado() { EscalonadorLibera(); }
+
+	EscalonadorBloqueado(const EscalonadorBloqueado &) = delete;
+	EscalonadorBloqueado &operator=(const EscalonadorBloqueado &) = delete;
+};
+
+/**
+* \class Tarefa
+* Tarefa com pilha estatica de PalavrasPilha palavras e prioridade fixa.
+* Cada combinacao de parametros define uma unica pilha; a verificacao do
+* tamanho minimo e da prioridade ocorre em tempo de compilacao.
+*
+* Uso: rtos::Tarefa<tarefa_1, 64, 2>::Cria("Tarefa 1");
+*/
+
+template <tarefa_t Funcao, uint16_t PalavrasPilha, prioridade_t Prioridade>
+class Tarefa
+{
+	static_assert(PalavrasPilha >= TAM_MINIMO_PILHA + cfg_PILHA_PALAVRAS_GUARDA, "pilha menor que o minimo");
+	static_assert(Prioridade <= PRIORIDADE_MAXIMA, "prioridade maior que PRIORIDADE_MAXIMA");
+
+public:
+	static void Cria(const char *nome)
+	{
+		CriaTarefa(Funcao, nome, pilha, PalavrasPilha, Prioridade);
+	}
+
+	/* numero da tarefa para os servicos do kernel, valido enquanto a
+	   prioridade nao for alterada com TarefaMudaPrioridade() */
+	static uint8_t Id() { return Prioridades[Prioridade]; }
+
+	static void Suspende() { TarefaSuspende(Id()); }
+	static void Continua() { TarefaContinua(Id()); }
+
+private:
+	static uint32_t pilha[PalavrasPilha];
+};
+
+template <tarefa_t Funcao, uint16_t PalavrasPilha, prioridade_t Prioridade>
+uint32_t Tarefa<Funcao, PalavrasPilha, Prioridade>::pilha[PalavrasPilha];
+
+/* servicos da tarefa atual */
+inline void Espera(tick_t qtas_marcas) { TarefaEspera(qtas_marcas); }
+
+/**
+* \class Semaforo
+* Semaforo contador (semaforo_t)
+*/
+
+class Semaforo
+{
+public:
+	/* maximo 0: contador sem limite (UINT32_MAX) */
+	constexpr explicit Semaforo(uint32_t inicial = 0, uint32_t maximo = 0) : sem{inicial, 0, maximo} {}
+
+	void Aguarda() { SemaforoAguarda(&sem); }
+	bool TentaAguardar() { return SemaforoTentaAguardar(&sem) == STATUS_OK; }
+	bool Libera() { return SemaforoLibera(&sem) == STATUS_OK; }
+	bool Libera(uint32_t n) { return SemaforoLiberaN(&sem, n) == STATUS_OK; }
+	uint8_t LiberaTodas() { return SemaforoLiberaTodas(&sem); }
+	bool LiberaISR() { return SemaforoLiberaISR(&sem) == STATUS_OK; }
+
+	uint32_t Contador() const { return sem.contador; }
+	semaforo_t *Nativo() { return &sem; }
+
+	Semaforo(const Semaforo &) = delete;
+	Semaforo &operator=(const Semaforo &) = delete;
+
+private:
+	semaforo_t sem;
+};
+
+/**
+* \class Mutex
+* Mutex do kernel (mutex_t), com dona e heranca de prioridade
+*/
+
+class Mutex
+{
+public:
+	constexpr Mutex() : mtx{0, 0, 0} {}
+
+	bool Trava() { return MutexTrava(&mtx) == STATUS_OK; }
+	bool TentaTravar() { return MutexTentaTravar(&mtx) == STATUS_OK; }
+	void Destrava() { MutexDestrava(&mtx); }
+
+	mutex_t *Nativo() { return &mtx; }
+
+	Mutex(const Mutex &) = delete;
+	Mutex &operator=(const Mutex &) = delete;
+
+private:
+	mutex_t mtx;
+};
+
+/**
+* \class Condicao
+* Variavel de condicao (condicao_t); Aguarda() deve ser chamada com o mutex obtido
+*
+* Uso: while(!pronto) { cond.Aguarda(mutex); }
+*/
+
+class Condicao
+{
+public:
+	constexpr Condicao() : cond{nullptr, 0} {}
+
+	void Aguarda(Mutex &m) { CondicaoAguarda(&cond, m.Nativo()); }
+	void Sinaliza() { CondicaoSinaliza(&cond); }
+	void SinalizaTodas() { CondicaoSinalizaTodas(&cond); }
+
+	Condicao(const Condicao &) = delete;
+	Condicao &operator=(const Condicao &) = delete;
+
+private:
+	condicao_t cond;
+};
+
+/**
+* \class Trava
+* Mutex obtido no construtor e liberado no destrutor, somente se foi obtido
+*
+* Uso: rtos::Trava t(mutex); if(t) { ... }
+*/
+
+class Trava
+{
+public:
+	explicit Trava(Mutex &m) : mutex(m), obtido(m.Trava()) {}
+	~Trava() { if(obtido) { mutex.Destrava(); } }
+
+	explicit operator bool() const { return obtido; }
+
+	Trava(const Trava &) = delete;
+	Trava &operator=(const Trava &) = delete;
+
+private:
+	Mutex &mutex;
+	bool obtido;
+};
+
+/**
+* \class TravaLeituraEscrita
+* Trava de leitura e escrita (trava_le_t), com preferencia para a escrita
+*/
+
+class TravaLeituraEscrita
+{
+public:
+	constexpr TravaLeituraEscrita() : trava{0, 0, 0, 0} {}
+
+	void ObtemLeitura() { TravaLeituraObtem(&trava); }
+	void LiberaLeitura() { TravaLeituraLibera(&trava); }
+	void ObtemEscrita() { TravaEscritaObtem(&trava); }
+	void LiberaEscrita() { TravaEscritaLibera(&trava); }
+
+	TravaLeituraEscrita(const TravaLeituraEscrita &) = delete;
+	TravaLeituraEscrita &operator=(const TravaLeituraEscrita &) = delete;
+
+private:
+	trava_le_t trava;
+};
+
+#if cfg_LIMIAR_PREEMPCAO
+/**
+* \class Recurso
+* Recurso com teto de prioridade imediato (recurso_t); Obtido o mantem com o
+* tempo de vida do objeto e o libera somente se foi obtido
+*/
+
+class Recurso
+{
+public:
+	constexpr explicit Recurso(prioridade_t teto) : rec RECURSO_INICIAL(teto) {}
+
+	bool Obtem() { return RecursoObtem(&rec) == STATUS_OK; }
+	bool Libera() { return RecursoLibera(&rec) == STATUS_OK; }
+
+	Recurso(const Recurso &) = delete;
+	Recurso &operator=(const Recurso &) = delete;
+
+private:
+	recurso_t rec;
+};
+
+class Obtido
+{
+public:
+	explicit Obtido(Recurso &r) : recurso(r), obtido(r.Obtem()) {}
+	~Obtido() { if(obtido) { recurso.Libera(); } }
+
+	explicit operator bool() const { return obtido; }
+
+	Obtido(const Obtido &) = delete;
+	Obtido &operator=(const Obtido &) = delete;
+
+private:
+	Recurso &recurso;
+	bool obtido;
+};
+#endif
+
+/**
+* \class Fila
+* Fila de N elementos do tipo T, com um semaforo para as posicoes livres e
+* outro para as ocupadas (produtor/consumidor). Envia() bloqueia com a fila
+* cheia e Recebe() com a fila vazia. T e copiado na regiao critica e deve
+* ser pequeno.
+*
+* Para esperar por varias filas ou semaforos, o semaforo Itens() entra em
+* SemaforoAguardaQualquer() e o item e retirado com RecebeObtido().
+*/
+
+template <typename T, uint8_t N>
+class Fila
+{
+	static_assert(N > 0, "fila sem elementos");
+
+public:
+	constexpr Fila() : vazio(N, N), cheio(0, N), buffer{}, inicio(0), fim(0) {}
+
+	void Envia(const T &item)
+	{
+		vazio.Aguarda();
+		{
+			RegiaoCritica r;
+			buffer[fim] = item;
+			fim = (uint8_t)((fim + 1) % N);
+		}
+		cheio.Libera();
+	}
+
+	T Recebe()
+	{
+		cheio.Aguarda();
+		return RecebeObtido();
+	}
+
+	/* retira um item ja obtido no semaforo Itens() */
+	T RecebeObtido()
+	{
+		T item;
+
+		{
+			RegiaoCritica r;
+			item = buffer[inicio];
+			inicio = (uint8_t)((inicio + 1) % N);
+		}
+		vazio.Libera();
+		return item;
+	}
+
+	uint8_t Quantidade() const { return (uint8_t)cheio.Contador(); }
+	semaforo_t *Itens() { return cheio.Nativo(); }
+
+	Fila(const Fila &) = delete;
+	Fila &operator=(const Fila &) = delete;
+
+private:
+	Semaforo	vazio;
+	Semaforo	cheio;
+	T			buffer[N];
+	uint8_t		inicio;
+	uint8_t		fim;
+};
+
+} /* namespace rtos */
+
+#endif /* MULTITAREFAS_HPP_ */
@@ -0,0 +1,313 @@
+/*
+ * shell.c
+ *
+ * Shell de inspecao do sistema multitarefas, com saida gerada uma linha por vez.
+ */
+
+#include <asf.h>
+#include <string.h>
+#include "rtos.h"
+#include "shell.h"
+
+#if cfg_ESTATISTICAS
+
+/* monta a linha de numero indice da saida do comando; 0: nao ha mais linhas */
+typedef uint8_t (*shell_gera_linha_t)(char *linha, uint8_t indice);
+
+static const shell_backend_t	*backend_shell = NULL;
+
+static char					comando[cfg_SHELL_TAM_COMANDO];
+static uint8_t				tamanho_comando = 0;
+
+static shell_gera_linha_t	gerador = NULL;		/* comando em andamento */
+static uint8_t				proxima_linha = 0;
+static char					linha[cfg_SHELL_TAM_LINHA];
+
+/* acrescenta o texto em uma coluna de largura caracteres (0: sem coluna),
+   alinhado a esquerda e truncado para caber na coluna */
+static uint8_t Texto(char *saida, uint8_t pos, const char *texto, uint8_t largura)
+{
+	uint8_t n = 0;
+
+	while(texto[n] != '\0' && (largura == 0 || n < largura - 1) && pos < cfg_SHELL_TAM_LINHA - 1)
+	{
+		saida[pos++] = texto[n++];
+	}
+	while(n < largura && pos < cfg_SHELL_TAM_LINHA - 1)
+	{
+		saida[pos++] = ' ';
+		n++;
+	}
+	saida[pos] = '\0';
+	return pos;
+}
+
+/* acrescenta o numero em uma coluna de largura caracteres, alinhado a direita */
+static uint8_t Numero(char *saida, uint8_t pos, uint32_t valor, uint8_t largura)
+{
+	char digitos[10];
+	uint8_t n = 0;
+
+	do
+	{
+		digitos[n++] = (char)('0' + valor % 10);
+		valor /= 10;
+	}while(valor != 0);
+
+	while(largura > n && pos < cfg_SHELL_TAM_LINHA - 1)
+	{
+		saida[pos++] = ' ';
+		largura--;
+	}
+	while(n > 0 && pos < cfg_SHELL_TAM_LINHA - 1)
+	{
+		saida[pos++] = digitos[--n];
+	}
+	saida[pos] = '\0';
+	return pos;
+}
+
+/* uma linha por tarefa; TCB[0] nao e usado e a linha 0 e o cabecalho */
+static uint8_t LinhaTarefas(char *saida, uint8_t indice)
+{
+	tcb_t tcb;
+	uint32_t marcas;
+	uint32_t por_mil = 0;
+	uint8_t atual;
+	uint8_t pos;
+
+	if(indice == 0)
+	{
+		(void)Texto(saida, 0, "tarefa          estado  prio  livre  cpu%  prazos", 0);
+		return 1;
+	}
+	if(indice > NUMERO_DE_TAREFAS)
+	{
+		return 0;
+	}
+
+	/* copia na regiao critica e formata fora dela */
+	REG_ATOMICA_INICIO();
+	tcb = TCB[indice];
+	marcas = EstatisticasKernel.marcas;
+	atual = tarefa_atual;
+	REG_ATOMICA_FIM();
+
+	if(tcb.nome == NULL)
+	{
+		return 0;
+	}
+	if(marcas > 0)
+	{
+		por_mil = (uint32_t)((uint64_t)tcb.marcas_cpu * 1000 / marcas);
+	}
+
+	pos = Texto(saida, 0, tcb.nome, 16);
+	pos = Texto(saida, pos, indice == atual ? "exec" : (tcb.estado == PRONTA ? "pronta" : "espera"), 7);
+	pos = Numero(saida, pos, tcb.prioridade, 5);
+	pos = Numero(saida, pos, PilhaMinimoLivre(indice), 7);
+	pos = Numero(saida, pos, por_mil / 10, 4);
+	pos = Texto(saida, pos, ".", 0);
+	pos = Numero(saida, pos, por_mil % 10, 1);
+	(void)Numero(saida, pos, tcb.prazos_perdidos, 8);
+	return 1;
+}
+
+/* uma linha por semaforo registrado, depois do cabecalho */
+static uint8_t LinhaSemaforos(char *saida, uint8_t indice)
+{
+	semaforo_t *sem;
+	semaforo_t copia;
+	const char *nome;
+	uint8_t esperando = 0;
+	uint8_t pos;
+
+	if(indice == 0)
+	{
+		(void)Texto(saida, 0, "semaforo           contador      maximo esperando", 0);
+		return 1;
+	}
+
+	sem = SemaforoRegistrado((uint8_t)(indice - 1), &nome);
+	if(sem == NULL)
+	{
+		return 0;
+	}
+
+	REG_ATOMICA_INICIO();
+	copia = *sem;
+	REG_ATOMICA_FIM();
+
+	while(copia.tarefasEsperando != 0)
+	{
+		copia.tarefasEsperando &= copia.tarefasEsperando - 1;
+		esperando++;
+	}
+
+	pos = Texto(saida, 0, nome, 16);
+	pos = Numero(saida, pos, copia.contador, 11);
+	pos = Numero(saida, pos, copia.maximo != 0 ? copia.maximo : UINT32_MAX, 12);
+	(void)Numero(saida, pos, esperando, 10);
+	return 1;
+}
+
+static uint8_t LinhaKernel(char *saida, uint8_t indice)
+{
+	estatisticas_kernel_t estatisticas;
+	uint8_t pos;
+
+	REG_ATOMICA_INICIO();
+	estatisticas = EstatisticasKernel;
+	REG_ATOMICA_FIM();
+
+	switch(indice)
+	{
+		case 0:
+			pos = Texto(saida, 0, "marcas de tempo", 20);
+			(void)Numero(saida, pos, estatisticas.marcas, 10);
+			return 1;
+		case 1:
+			pos = Texto(saida, 0, "trocas de contexto", 20);
+			(void)Numero(saida, pos, estatisticas.trocas_contexto, 10);
+			return 1;
+		case 2:
+			pos = Texto(saida, 0, "prazos perdidos", 20);
+			(void)Numero(saida, pos, estatisticas.prazos_perdidos, 10);
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+static uint8_t LinhaZera(char *saida, uint8_t indice)
+{
+	if(indice > 0)
+	{
+		return 0;
+	}
+	EstatisticasZera();
+	(void)Texto(saida, 0, "estatisticas zeradas", 0);
+	return 1;
+}
+
+static uint8_t LinhaAjuda(char *saida, uint8_t indice);
+
+static uint8_t LinhaDesconhecido(char *saida, uint8_t indice)
+{
+	if(indice > 0)
+	{
+		return 0;
+	}
+	(void)Texto(saida, 0, "comando desconhecido (ajuda: lista os comandos)", 0);
+	return 1;
+}
+
+static const struct
+{
+	const char			*nome;
+	shell_gera_linha_t	gera;
+	const char			*descricao;
+} comandos[] =
+{
+	{ "tarefas",	LinhaTarefas,	"estado, prioridade, pilha livre (palavras) e uso" },
+	{ "semaforos",	LinhaSemaforos,	"semaforos registrados com SemaforoRegistra()" },
+	{ "kernel",		LinhaKernel,	"marcas, trocas de contexto e prazos perdidos" },
+	{ "zera",		LinhaZera,		"zera os contadores e o uso das tarefas" },
+	{ "ajuda",		LinhaAjuda,		"esta lista" },
+};
+
+#define NUMERO_COMANDOS		(sizeof(comandos) / sizeof(comandos[0]))
+
+static uint8_t LinhaAjuda(char *saida, uint8_t indice)
+{
+	uint8_t pos;
+
+	if(indice >= NUMERO_COMANDOS)
+	{
+		return 0;
+	}
+	pos = Texto(saida, 0, comandos[indice].nome, 11);
+	(void)Texto(saida, pos, comandos[indice].descricao, 0);
+	return 1;
+}
+
+static void Interpreta(void)
+{
+	uint8_t i;
+
+	gerador = LinhaDesconhecido;
+	for(i = 0; i < NUMERO_COMANDOS; i++)
+	{
+		if(strcmp(comando, comandos[i].nome) == 0)
+		{
+			gerador = comandos[i].gera;
+			break;
+		}
+	}
+	proxima_linha = 0;
+}
+
+void ShellConecta(const shell_backend_t *backend)
+{
+	backend_shell = backend;
+}
+
+/* Um passo do shell: envia a proxima linha do comando em andamento ou le os
+   caracteres recebidos ate completar um comando. Retorna 1 se ha saida em
+   andamento (o proximo passo deve vir logo) e 0 se espera por comandos */
+uint8_t ShellExecuta(void)
+{
+	int16_t c;
+
+	if(backend_shell == NULL)
+	{
+		return 0;
+	}
+
+	if(gerador != NULL)
+	{
+		if(gerador(linha, proxima_linha))
+		{
+			proxima_linha++;
+			backend_shell->escreve(linha);
+			return 1;
+		}
+		gerador = NULL;
+	}
+
+	while((c = backend_shell->le()) >= 0)
+	{
+		if(c == '\r' || c == '\n')
+		{
+			if(tamanho_comando > 0)
+			{
+				comando[tamanho_comando] = '\0';
+				tamanho_comando = 0;
+				Interpreta();
+				return 1;
+			}
+		}
+		else if(tamanho_comando < cfg_SHELL_TAM_COMANDO - 1)
+		{
+			comando[tamanho_comando++] = (char)c;
+		}
+	}
+	return 0;
+}
+
+static void TarefaShell(void)
+{
+	for(;;)
+	{
+		/* cede o processador entre as linhas da saida */
+		TarefaEspera(ShellExecuta() ? 1 : cfg_SHELL_MARCAS_ESPERA);
+	}
+}
+
+void ShellInicia(const shell_backend_t *backend, stackptr_t pilha, uint16_t tamanho, prioridade_t prioridade)
+{
+	ShellConecta(backend);
+	CriaTarefa(TarefaShell, "Shell", pilha, tamanho, prioridade);
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * shell.h
+ *
+ * Shell de inspecao do sistema multitarefas em execucao, para diagnosticar um
+ * no sem depurador: lista as tarefas (nome, estado, prioridade, pilha livre,
+ * uso do processador e prazos perdidos), os semaforos registrados com
+ * SemaforoRegistra() (contador e tarefas esperando) e os contadores do kernel.
+ *
+ * - Requer cfg_ESTATISTICAS = 1 (rtos.h).
+ * - Os caracteres e as linhas passam por um backend (shell_backend_t): uma
+ *   UART no processador ou um pipe no computador (ferramentas/simulador,
+ *   opcao -p).
+ * - A saida e gerada uma linha por vez por ShellExecuta(): cada linha e
+ *   montada a partir de uma copia feita em uma regiao critica curta e, entre
+ *   as linhas, a tarefa do shell espera uma marca de tempo. O shell nunca
+ *   segura o escalonador e so atrasa tarefas de prioridade menor que a sua.
+ *
+ * Comandos: tarefas, semaforos, kernel, zera, ajuda
+ *
+ * Uso:
+ *
+ *   static int16_t UartLe(void) { ... caractere recebido ou -1, sem bloquear ... }
+ *   static void UartEscreve(const char *linha) { ... linha e "\r\n" ... }
+ *   static const shell_backend_t uart = { UartLe, UartEscreve };
+ *
+ *   SemaforoRegistra(&SemaforoCheio, "cheio");
+ *   ShellInicia(&uart, PILHA_SHELL, TAM_PILHA_SHELL, 1);
+ */
+
+#ifndef SHELL_H_
+#define SHELL_H_
+
+#include "rtos.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* maior comando recebido e maior linha de saida, em caracteres */
+#ifndef cfg_SHELL_TAM_COMANDO
+#define cfg_SHELL_TAM_COMANDO		16
+#endif
+
+#ifndef cfg_SHELL_TAM_LINHA
+#define cfg_SHELL_TAM_LINHA			64
+#endif
+
+/* marcas de tempo entre consultas ao backend sem comando em andamento */
+#ifndef cfg_SHELL_MARCAS_ESPERA
+#define cfg_SHELL_MARCAS_ESPERA		20
+#endif
+
+/**
+* \struct shell_backend_t
+* Entrada e saida do shell
+*/
+
+typedef struct
+{
+	int16_t	(*le)(void);					/* proximo caractere recebido (-1: nenhum), sem bloquear */
+	void	(*escreve)(const char *linha);	/* envia uma linha, sem o fim de linha */
+} shell_backend_t;
+
+void ShellInicia(const shell_backend_t *backend, stackptr_t pilha, uint16_t tamanho, prioridade_t prioridade);
+
+/* para executar o shell sem tarefa propria (por exemplo, no computador) */
+void ShellConecta(const shell_backend_t *backend);
+uint8_t ShellExecuta(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHELL_H_ */
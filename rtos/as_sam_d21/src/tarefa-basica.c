@@ -0,0 +1,178 @@
+/*
+ * tarefa-basica.c
+ *
+ * Tarefas basicas (OSEK BCC1) executadas, com preempcao por aninhamento, sobre
+ * a pilha de uma unica tarefa do kernel.
+ */
+
+#include <asf.h>
+#include "rtos.h"
+#include "tarefa-basica.h"
+
+static tarefa_basica_t	tarefas_basicas[TB_NUMERO_PRIORIDADES];
+
+/* uma tarefa basica por bit (bit = prioridade) */
+static volatile uint32_t	prontas = 0;
+static uint32_t				em_execucao = 0;
+
+/* prioridade + 1 da tarefa basica em execucao (0: nenhuma) */
+static uint8_t	nivel_atual = 0;
+static uint8_t	aninhamento = 0;
+static uint8_t	max_aninhamento = 0;
+
+static uint8_t		id_executora = 0;
+static semaforo_t	sinal = SEMAFORO_INICIAL(0, 0);
+static volatile uint8_t	sinal_pendente = 0;
+
+static uint8_t MaiorPrioridade(uint32_t conjunto)
+{
+	return (uint8_t)(31 - __builtin_clz(conjunto));
+}
+
+/* Executa, ate o fim e em ordem de prioridade, as tarefas basicas prontas com
+   prioridade maior que a da tarefa em execucao. Chamada pela executora, por
+   uma tarefa basica ou pela chamada aninhada empilhada no fim do PendSV
+   (aninhamento na mesma pilha) */
+static void Despacha(void)
+{
+	for(;;)
+	{
+		uint8_t prioridade;
+		uint8_t nivel_anterior;
+
+		REG_ATOMICA_INICIO();
+		if(prontas == 0 || MaiorPrioridade(prontas) < nivel_atual)
+		{
+			REG_ATOMICA_FIM();
+			return;
+		}
+		prioridade = MaiorPrioridade(prontas);
+		prontas &= ~(1UL << prioridade);
+		em_execucao |= (1UL << prioridade);
+		nivel_anterior = nivel_atual;
+		nivel_atual = (uint8_t)(prioridade + 1);
+		if(++aninhamento > max_aninhamento)
+		{
+			max_aninhamento = aninhamento;
+		}
+		REG_ATOMICA_FIM();
+
+		tarefas_basicas[prioridade]();
+
+		REG_ATOMICA_INICIO();
+		em_execucao &= ~(1UL << prioridade);
+		nivel_atual = nivel_anterior;
+		aninhamento--;
+		REG_ATOMICA_FIM();
+	}
+}
+
+/* corpo da tarefa executora */
+static void TarefaExecutora(void)
+{
+	for(;;)
+	{
+		SemaforoAguarda(&sinal);
+		sinal_pendente = 0;
+		Despacha();
+	}
+}
+
+/* Fim do PendSV (cpu-port.c): a executora retomada durante uma tarefa basica
+   despacha antes as tarefas basicas prontas de maior prioridade */
+stackptr_t TrocaContextoFimGancho(stackptr_t pilha)
+{
+	if(tarefa_atual == id_executora && nivel_atual > 0 &&
+	   prontas != 0 && MaiorPrioridade(prontas) >= nivel_atual)
+	{
+		return EmpilhaChamadaAninhada(pilha, Despacha);
+	}
+	return pilha;
+}
+
+/* Cria a tarefa do kernel cuja pilha e compartilhada pelas tarefas basicas.
+   O tamanho deve cobrir a cadeia mais longa de tarefas aninhadas */
+void TarefasBasicasInicia(const char *nome, stackptr_t pilha, uint16_t tamanho, prioridade_t prioridade)
+{
+	CriaTarefa(TarefaExecutora, nome, pilha, tamanho, prioridade);
+	id_executora = Prioridades[prioridade];
+}
+
+enum status_code TarefaBasicaDeclara(uint8_t prioridade, tarefa_basica_t funcao)
+{
+	if(prioridade >= TB_NUMERO_PRIORIDADES || funcao == NULL)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+	if(tarefas_basicas[prioridade] != NULL)
+	{
+		return STATUS_ERR_DENIED;	/* BCC1: uma tarefa por prioridade */
+	}
+	tarefas_basicas[prioridade] = funcao;
+	return STATUS_OK;
+}
+
+/* Ativa uma tarefa basica (ActivateTask() do OSEK). Pode ser chamada por
+   tarefas basicas, tarefas do kernel e interrupcoes */
+enum status_code TarefaBasicaAtiva(uint8_t prioridade)
+{
+	uint32_t bit;
+
+	if(prioridade >= TB_NUMERO_PRIORIDADES || tarefas_basicas[prioridade] == NULL)
+	{
+		return STATUS_ERR_INVALID_ARG;
+	}
+	bit = 1UL << prioridade;
+
+	REG_ATOMICA_INICIO();
+	if((prontas | em_execucao) & bit)
+	{
+		REG_ATOMICA_FIM();
+		return STATUS_BUSY;			/* BCC1: uma unica ativacao */
+	}
+	prontas |= bit;
+	if(EM_INTERRUPCAO() && nivel_atual > 0 && prioridade >= nivel_atual)
+	{
+		troca_pendente_isr = 1;		/* preempta no fim do PendSV */
+	}
+	REG_ATOMICA_FIM();
+
+	if(!EM_INTERRUPCAO() && tarefa_atual == id_executora && nivel_atual > 0)
+	{
+		Despacha();					/* chamada por uma tarefa basica: aninha */
+	}
+	else
+	{
+		REG_ATOMICA_INICIO();
+		if(!sinal_pendente)
+		{
+			sinal_pendente = 1;
+			if(EM_INTERRUPCAO())
+			{
+				(void)SemaforoLiberaISR(&sinal);
+			}
+			else
+			{
+				(void)SemaforoLibera(&sinal);
+			}
+		}
+		REG_ATOMICA_FIM();
+	}
+	return STATUS_OK;
+}
+
+/* Ponto de escalonamento explicito (Schedule() do OSEK): executa as tarefas
+   basicas de maior prioridade ja prontas, sem esperar pelo PendSV */
+void TarefaBasicaEscalona(void)
+{
+	if(!EM_INTERRUPCAO() && tarefa_atual == id_executora)
+	{
+		Despacha();
+	}
+}
+
+/* maior numero de tarefas basicas aninhadas ja observado */
+uint8_t TarefaBasicaMaxAninhamento(void)
+{
+	return max_aninhamento;
+}
@@ -0,0 +1,59 @@
+/*
+ * tarefa-basica.h
+ *
+ * Tarefas basicas no estilo OSEK BCC1: executam ate o fim (run-to-completion),
+ * sem pilha propria, sobre a pilha unica de uma tarefa do kernel (executora).
+ * Entre si sao escalonadas com preempcao (FULL do OSEK): uma tarefa basica de
+ * maior prioridade interrompe a que esta em execucao, aninhada na mesma pilha.
+ *
+ * - Cada tarefa basica tem uma prioridade unica (0 a 31, maior numero e maior
+ *   prioridade) e no maximo uma ativacao pendente: ativar uma tarefa pronta ou
+ *   em execucao retorna STATUS_BUSY (E_OS_LIMIT no OSEK).
+ * - Uma tarefa basica de maior prioridade ativada por outra tarefa basica
+ *   executa imediatamente, aninhada na pilha (chamada de funcao), e a tarefa
+ *   interrompida continua quando ela termina. Assim a pilha necessaria e a
+ *   soma das pilhas de uma cadeia de prioridades crescentes, e nao a soma de
+ *   todas as tarefas (ver TarefaBasicaMaxAninhamento()).
+ * - Ativacoes feitas por interrupcoes ou por outras tarefas do kernel
+ *   preemptam a tarefa basica de menor prioridade em execucao no fim do
+ *   PendSV que retoma a executora (TrocaContextoFimGancho()): um quadro de
+ *   excecao empilhado sobre o codigo interrompido faz a executora despachar
+ *   as tarefas basicas de maior prioridade e so depois continuar. Cada
+ *   preempcao ocupa na pilha da executora, alem da tarefa aninhada, dois
+ *   quadros de excecao (64 bytes).
+ * - Interrupcoes que ativam tarefas basicas terminam com FIM_DE_INTERRUPCAO(),
+ *   que solicita o PendSV.
+ * - TarefaBasicaEscalona() (o Schedule() do OSEK) continua disponivel como
+ *   ponto de escalonamento explicito.
+ *
+ * Limites: tarefas basicas nao podem bloquear (SemaforoAguarda, TarefaEspera,
+ * ...), o que bloquearia a executora e todas as tarefas basicas. Tarefas do
+ * kernel de maior prioridade continuam preemptando a executora normalmente.
+ */
+
+#ifndef TAREFA_BASICA_H_
+#define TAREFA_BASICA_H_
+
+#include "rtos.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TB_NUMERO_PRIORIDADES		32
+
+typedef void (*tarefa_basica_t)(void);
+
+void TarefasBasicasInicia(const char *nome, stackptr_t pilha, uint16_t tamanho, prioridade_t prioridade);
+enum status_code TarefaBasicaDeclara(uint8_t prioridade, tarefa_basica_t funcao);
+
+enum status_code TarefaBasicaAtiva(uint8_t prioridade);
+void TarefaBasicaEscalona(void);
+
+uint8_t TarefaBasicaMaxAninhamento(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TAREFA_BASICA_H_ */
@@ -0,0 +1,361 @@
+/*
+ * analise_rta.c
+ *
+ * Analise de escalonabilidade (analise do tempo de resposta) para o
+ * escalonador de prioridades fixas do sistema multitarefas (escalonador()).
+ *
+ * Executada no computador (host), antes de gravar o firmware. Le uma tabela
+ * de tarefas com os mesmos dados passados a CriaTarefa() (nome e prioridade)
+ * acrescidos dos dados temporais (periodo, tempo de execucao no pior caso e
+ * bloqueio) e informa, para cada tarefa, o tempo de resposta no pior caso e
+ * se o prazo e cumprido.
+ *
+ * Os custos da marca de tempo e da troca de contexto sao informados em ciclos
+ * de clock, tal como medidos no kernel real com cfg_MEDE_CUSTOS = 1
+ * (custo_max_marca_tempo e custo_max_troca_contexto).
+ *
+ * Por padrao a analise e cooperativa, como o firmware com
+ * cfg_PREEMPCAO_NA_MARCA = 0 (a marca de tempo nao solicita troca de
+ * contexto); a opcao -P analisa o firmware com cfg_PREEMPCAO_NA_MARCA = 1.
+ *
+ * Uso: analise_rta [opcoes] tabela.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define MAX_TAREFAS		64
+#define MAX_NOME		32
+#define MAX_ITERACOES	100000
+
+/* o periodo ocupado de nivel i so e limitado se a utilizacao das tarefas de
+   prioridade maior ou igual for menor que 1: acima deste numero de ativacoes
+   da tarefa a iteracao e considerada divergente */
+#define LIMITE_DIVERGENCIA	1000.0
+
+/* tempo de resposta de uma tarefa que certamente perde o prazo: a iteracao e
+   interrompida assim que ultrapassa o prazo ou LIMITE_DIVERGENCIA */
+#define NAO_ESCALONAVEL		(-1.0)
+
+typedef struct
+{
+	char		nome[MAX_NOME];
+	unsigned	prioridade;
+	double		periodo;	/* us */
+	double		wcet;		/* us */
+	double		bloqueio;	/* us */
+	double		prazo;		/* us */
+	double		resposta;	/* us, resultado da analise */
+	int			cumpre;
+} tarefa_rta_t;
+
+/* parametros da analise */
+static double	clock_hz = 48000000.0;		/* cfg_CPU_CLOCK_HZ */
+static double	marca_hz = 1000.0;			/* cfg_MARCA_TEMPO_HZ */
+static double	ciclos_marca = 0.0;			/* custo_max_marca_tempo */
+static double	ciclos_troca = 0.0;			/* custo_max_troca_contexto */
+static int		cooperativo = 1;		/* cfg_PREEMPCAO_NA_MARCA = 0 */
+
+static tarefa_rta_t	tarefas[MAX_TAREFAS];
+static int			numero_tarefas = 0;
+
+static void uso(const char *programa)
+{
+	fprintf(stderr,
+		"uso: %s [opcoes] tabela.txt\n"
+		"  -f HZ      frequencia de clock da CPU (padrao 48000000)\n"
+		"  -t HZ      frequencia da marca de tempo (padrao 1000)\n"
+		"  -m CICLOS  custo da marca de tempo (custo_max_marca_tempo)\n"
+		"  -x CICLOS  custo da troca de contexto (custo_max_troca_contexto)\n"
+		"  -c         escalonamento cooperativo, sem preempcao na marca de tempo (padrao)\n"
+		"  -P         preempcao na marca de tempo (cfg_PREEMPCAO_NA_MARCA = 1)\n"
+		"\n"
+		"tabela: uma tarefa por linha, tempos em microssegundos\n"
+		"  nome prioridade periodo wcet [bloqueio [prazo]]\n",
+		programa);
+}
+
+static int le_tabela(const char *arquivo)
+{
+	FILE *f = fopen(arquivo, "r");
+	char linha[256];
+	int num_linha = 0;
+
+	if(f == NULL)
+	{
+		perror(arquivo);
+		return -1;
+	}
+
+	while(fgets(linha, sizeof(linha), f) != NULL)
+	{
+		tarefa_rta_t *t;
+		int campos;
+
+		num_linha++;
+		if(linha[strspn(linha, " \t\r\n")] == '\0' || linha[strspn(linha, " \t")] == '#')
+		{
+			continue;	/* linha vazia ou comentario */
+		}
+
+		if(numero_tarefas == MAX_TAREFAS)
+		{
+			fprintf(stderr, "%s:%d: excesso de tarefas (maximo %d)\n", arquivo, num_linha, MAX_TAREFAS);
+			fclose(f);
+			return -1;
+		}
+
+		t = &tarefas[numero_tarefas];
+		t->bloqueio = 0.0;
+		t->prazo = 0.0;
+		campos = sscanf(linha, "%31s %u %lf %lf %lf %lf", t->nome, &t->prioridade,
+						&t->periodo, &t->wcet, &t->bloqueio, &t->prazo);
+		if(campos < 4 || t->periodo <= 0.0 || t->wcet < 0.0)
+		{
+			fprintf(stderr, "%s:%d: linha invalida\n", arquivo, num_linha);
+			fclose(f);
+			return -1;
+		}
+		if(t->prazo <= 0.0)
+		{
+			t->prazo = t->periodo;	/* prazo implicito igual ao periodo */
+		}
+		numero_tarefas++;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+/* o escalonador permite uma unica tarefa por prioridade (vetor Prioridades[]) */
+static int verifica_prioridades(void)
+{
+	int i, j;
+
+	for(i = 0; i < numero_tarefas; i++)
+	{
+		if(tarefas[i].prioridade == 0)
+		{
+			fprintf(stderr, "%s: prioridade 0 e reservada para a tarefa ociosa\n", tarefas[i].nome);
+			return -1;
+		}
+		for(j = i + 1; j < numero_tarefas; j++)
+		{
+			if(tarefas[i].prioridade == tarefas[j].prioridade)
+			{
+				fprintf(stderr, "%s e %s: prioridades repetidas (%u)\n",
+						tarefas[i].nome, tarefas[j].nome, tarefas[i].prioridade);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+/* tempo de execucao acrescido das duas trocas de contexto (entrada e saida) */
+static double custo_tarefa(const tarefa_rta_t *t)
+{
+	return t->wcet + 2.0 * (ciclos_troca * 1e6 / clock_hz);
+}
+
+/* interferencia da marca de tempo em uma janela de duracao w */
+static double interferencia_marca(double w, int fechada)
+{
+	double periodo_marca = 1e6 / marca_hz;
+	double custo_marca = ciclos_marca * 1e6 / clock_hz;
+	double n = fechada ? floor(w / periodo_marca) + 1.0 : ceil(w / periodo_marca);
+
+	return n * custo_marca;
+}
+
+/* maior tempo de execucao entre as tarefas de menor prioridade que i;
+   no modo cooperativo uma tarefa so cede o processador ao chamar um servico */
+static double bloqueio_nao_preemptivo(const tarefa_rta_t *ti)
+{
+	double maior = 0.0;
+	int j;
+
+	for(j = 0; j < numero_tarefas; j++)
+	{
+		if(tarefas[j].prioridade < ti->prioridade && custo_tarefa(&tarefas[j]) > maior)
+		{
+			maior = custo_tarefa(&tarefas[j]);
+		}
+	}
+	return maior;
+}
+
+/* analise do tempo de resposta com preempcao (Joseph & Pandya, com bloqueio
+   e sobrecarga da marca de tempo); NAO_ESCALONAVEL se passar do prazo */
+static double resposta_preemptivo(const tarefa_rta_t *ti)
+{
+	double r = custo_tarefa(ti) + ti->bloqueio;
+	double anterior = 0.0;
+	int iteracao, j;
+
+	for(iteracao = 0; iteracao < MAX_ITERACOES && r != anterior; iteracao++)
+	{
+		anterior = r;
+		r = custo_tarefa(ti) + ti->bloqueio + interferencia_marca(anterior, 0);
+		for(j = 0; j < numero_tarefas; j++)
+		{
+			if(tarefas[j].prioridade > ti->prioridade)
+			{
+				r += ceil(anterior / tarefas[j].periodo) * custo_tarefa(&tarefas[j]);
+			}
+		}
+		if(r > ti->prazo)
+		{
+			return NAO_ESCALONAVEL;	/* a resposta so cresce: perde o prazo */
+		}
+	}
+	return r;
+}
+
+/* analise sem preempcao entre tarefas (Davis et al., 2007): examina todas
+   as ativacoes da tarefa dentro do periodo ocupado de nivel i;
+   NAO_ESCALONAVEL se alguma passar do prazo ou se o periodo ocupado divergir */
+static double resposta_cooperativo(const tarefa_rta_t *ti)
+{
+	double bloqueio = ti->bloqueio + bloqueio_nao_preemptivo(ti);
+	double ci = custo_tarefa(ti);
+	double periodo_ocupado = bloqueio + ci;
+	double anterior = 0.0;
+	double pior = 0.0;
+	int iteracao, j, q, ativacoes;
+
+	/* duracao do periodo ocupado de nivel i */
+	for(iteracao = 0; iteracao < MAX_ITERACOES && periodo_ocupado != anterior; iteracao++)
+	{
+		anterior = periodo_ocupado;
+		periodo_ocupado = bloqueio + interferencia_marca(anterior, 0);
+		for(j = 0; j < numero_tarefas; j++)
+		{
+			if(tarefas[j].prioridade >= ti->prioridade)
+			{
+				periodo_ocupado += ceil(anterior / tarefas[j].periodo) * custo_tarefa(&tarefas[j]);
+			}
+		}
+		if(periodo_ocupado > LIMITE_DIVERGENCIA * ti->periodo)
+		{
+			return NAO_ESCALONAVEL;
+		}
+	}
+
+	ativacoes = (int)ceil(periodo_ocupado / ti->periodo);
+	for(q = 0; q < ativacoes; q++)
+	{
+		/* instante de inicio da ativacao q */
+		double w = bloqueio + q * ci;
+		double r;
+
+		anterior = -1.0;
+		for(iteracao = 0; iteracao < MAX_ITERACOES && w != anterior; iteracao++)
+		{
+			anterior = w;
+			w = bloqueio + q * ci + interferencia_marca(anterior, 1);
+			for(j = 0; j < numero_tarefas; j++)
+			{
+				if(tarefas[j].prioridade > ti->prioridade)
+				{
+					w += (floor(anterior / tarefas[j].periodo) + 1.0) * custo_tarefa(&tarefas[j]);
+				}
+			}
+			if(w + ci - q * ti->periodo > ti->prazo)
+			{
+				return NAO_ESCALONAVEL;
+			}
+		}
+
+		r = w + ci - q * ti->periodo;
+		if(r > pior)
+		{
+			pior = r;
+		}
+	}
+	return pior;
+}
+
+int main(int argc, char **argv)
+{
+	double utilizacao = 0.0;
+	int escalonavel = 1;
+	int i;
+
+	for(i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if(strcmp(argv[i], "-c") == 0)
+		{
+			cooperativo = 1;
+		}
+		else if(strcmp(argv[i], "-P") == 0)
+		{
+			cooperativo = 0;
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "-f") == 0)
+		{
+			clock_hz = atof(argv[++i]);
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "-t") == 0)
+		{
+			marca_hz = atof(argv[++i]);
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "-m") == 0)
+		{
+			ciclos_marca = atof(argv[++i]);
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "-x") == 0)
+		{
+			ciclos_troca = atof(argv[++i]);
+		}
+		else
+		{
+			uso(argv[0]);
+			return 2;
+		}
+	}
+
+	if(i != argc - 1 || clock_hz <= 0.0 || marca_hz <= 0.0)
+	{
+		uso(argv[0]);
+		return 2;
+	}
+
+	if(le_tabela(argv[i]) != 0 || verifica_prioridades() != 0)
+	{
+		return 2;
+	}
+
+	printf("%-16s %5s %10s %10s %10s %10s  %s\n",
+		   "tarefa", "prio", "periodo", "wcet", "prazo", "resposta", "situacao");
+
+	for(i = 0; i < numero_tarefas; i++)
+	{
+		tarefa_rta_t *t = &tarefas[i];
+
+		t->resposta = cooperativo ? resposta_cooperativo(t) : resposta_preemptivo(t);
+		t->cumpre = (t->resposta != NAO_ESCALONAVEL && t->resposta <= t->prazo);
+		escalonavel = escalonavel && t->cumpre;
+		utilizacao += custo_tarefa(t) / t->periodo;
+
+		printf("%-16s %5u %10.1f %10.1f %10.1f ",
+			   t->nome, t->prioridade, t->periodo, t->wcet, t->prazo);
+		if(t->cumpre)
+		{
+			printf("%10.1f  ok\n", t->resposta);
+		}
+		else
+		{
+			printf("%10s  PERDE O PRAZO\n", "> prazo");
+		}
+	}
+
+	utilizacao += ciclos_marca * marca_hz / clock_hz;
+	printf("\nutilizacao total (com sobrecargas): %.1f%%\n", utilizacao * 100.0);
+	printf("conjunto de tarefas %s\n", escalonavel ? "escalonavel" : "NAO escalonavel");
+
+	return escalonavel ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/*
+ * exemplo.c
+ *
+ * Produtor/consumidor escrito diretamente com a API em C (rtos.h).
+ * Deve permanecer equivalente a exemplo.cpp, que usa rtos.hpp.
+ */
+
+#include "rtos.h"
+
+#define TAM_PILHA	64
+#define TAM_FILA	4
+
+void CriaTarefasExemplo(void);
+
+static uint32_t PILHA_PRODUTOR[TAM_PILHA];
+static uint32_t PILHA_CONSUMIDOR[TAM_PILHA];
+
+static semaforo_t SemaforoVazio = SEMAFORO_INICIAL(TAM_FILA, TAM_FILA);
+static semaforo_t SemaforoCheio = SEMAFORO_INICIAL(0, TAM_FILA);
+static mutex_t Mutex = {0};
+
+static uint16_t buffer[TAM_FILA];
+static uint8_t inicio = 0;
+static uint8_t fim = 0;
+
+static uint32_t total = 0;
+static uint32_t recebidos = 0;
+
+static void envia(uint16_t valor)
+{
+	SemaforoAguarda(&SemaforoVazio);
+	REG_ATOMICA_INICIO();
+	buffer[fim] = valor;
+	fim = (uint8_t)((fim + 1) % TAM_FILA);
+	REG_ATOMICA_FIM();
+	SemaforoLibera(&SemaforoCheio);
+}
+
+static uint16_t recebe(void)
+{
+	uint16_t valor;
+
+	SemaforoAguarda(&SemaforoCheio);
+	REG_ATOMICA_INICIO();
+	valor = buffer[inicio];
+	inicio = (uint8_t)((inicio + 1) % TAM_FILA);
+	REG_ATOMICA_FIM();
+	SemaforoLibera(&SemaforoVazio);
+	return valor;
+}
+
+static void produtor(void)
+{
+	uint16_t valor = 0;
+
+	for(;;)
+	{
+		envia(valor++);
+		TarefaEspera(1);
+	}
+}
+
+static void consumidor(void)
+{
+	for(;;)
+	{
+		uint16_t valor = recebe();
+
+		if(MutexTrava(&Mutex) == STATUS_OK)
+		{
+			total += valor;
+			MutexDestrava(&Mutex);
+		}
+
+		REG_ATOMICA_INICIO();
+		recebidos++;
+		REG_ATOMICA_FIM();
+	}
+}
+
+void CriaTarefasExemplo(void)
+{
+	CriaTarefa(produtor, "Produtor", PILHA_PRODUTOR, TAM_PILHA, 2);
+	CriaTarefa(consumidor, "Consumidor", PILHA_CONSUMIDOR, TAM_PILHA, 1);
+	TarefaSuspende(Prioridades[1]);
+	TarefaContinua(Prioridades[1]);
+}
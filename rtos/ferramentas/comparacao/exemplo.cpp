@@ -0,0 +1,60 @@
+/*
+ * exemplo.cpp
+ *
+ * Produtor/consumidor escrito com a camada C++ (rtos.hpp).
+ * Deve permanecer equivalente a exemplo.c, que usa a API em C.
+ */
+
+#include "rtos.hpp"
+
+#define TAM_PILHA	64
+#define TAM_FILA	4
+
+extern "C" void CriaTarefasExemplo(void);
+
+static rtos::Fila<uint16_t, TAM_FILA> fila;
+static rtos::Mutex mutex;
+
+static uint32_t total = 0;
+static uint32_t recebidos = 0;
+
+static void produtor(void)
+{
+	uint16_t valor = 0;
+
+	for(;;)
+	{
+		fila.Envia(valor++);
+		rtos::Espera(1);
+	}
+}
+
+static void consumidor(void)
+{
+	for(;;)
+	{
+		uint16_t valor = fila.Recebe();
+
+		{
+			rtos::Trava t(mutex);
+			if(t)
+			{
+				total += valor;
+			}
+		}
+
+		rtos::RegiaoCritica r;
+		recebidos++;
+	}
+}
+
+typedef rtos::Tarefa<produtor, TAM_PILHA, 2> Produtor;
+typedef rtos::Tarefa<consumidor, TAM_PILHA, 1> Consumidor;
+
+void CriaTarefasExemplo(void)
+{
+	Produtor::Cria("Produtor");
+	Consumidor::Cria("Consumidor");
+	Consumidor::Suspende();
+	Consumidor::Continua();
+}
@@ -0,0 +1,26 @@
+/*
+ * porta.h
+ *
+ * Incluido apos porta-host/cpu-port.h na comparacao de tamanho: as regioes
+ * criticas passam a chamar funcoes, como no processador, para que o codigo
+ * gerado por REG_ATOMICA_INICIO/REG_ATOMICA_FIM apareca na comparacao.
+ */
+
+#ifndef COMPARACAO_PORTA_H_
+#define COMPARACAO_PORTA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void EntraRegiaoCritica(void);
+void SaiRegiaoCritica(void);
+#ifdef __cplusplus
+}
+#endif
+
+#undef REG_ATOMICA_INICIO
+#undef REG_ATOMICA_FIM
+#define REG_ATOMICA_INICIO()	EntraRegiaoCritica();
+#define REG_ATOMICA_FIM()		SaiRegiaoCritica();
+
+#endif /* COMPARACAO_PORTA_H_ */
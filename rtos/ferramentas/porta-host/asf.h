@@ -0,0 +1,17 @@
+/*
+ * asf.h
+ *
+ * Substituto do cabecalho do ASF para compilar o kernel (rtos.c) no
+ * computador (host), usado pelas ferramentas de simulacao.
+ */
+
+#ifndef ASF_H
+#define ASF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../../as_sam_d21/src/ASF/sam0/utils/status_codes.h"
+
+#define Assert(expr)	((void) 0)
+
+#endif /* ASF_H */
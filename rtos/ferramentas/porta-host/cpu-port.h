@@ -0,0 +1,47 @@
+/*
+ * cpu-port.h
+ *
+ * Porta do sistema multitarefas para o computador (host), usada pelas
+ * ferramentas de simulacao. Nao ha troca de contexto real: a solicitacao de
+ * troca apenas sinaliza o simulador, que chama TrocaContextoDasTarefas().
+ *
+ * Deve ser incluido antes de rtos.h (opcao -include do compilador), para
+ * substituir o cpu-port.h do processador.
+ */
+
+#ifndef CPU_PORT_H_
+#define CPU_PORT_H_
+
+#include <stdint.h>
+
+#define TAM_MINIMO_PILHA  (16)
+
+/* tipo do ponteiro de pilha */
+typedef uint32_t* stackptr_t;
+
+/* sinalizacao de troca de contexto para o simulador */
+#ifdef __cplusplus
+extern "C" volatile uint8_t sim_troca_solicitada;
+#else
+extern volatile uint8_t sim_troca_solicitada;
+#endif
+
+#define REG_ATOMICA_INICIO()
+#define REG_ATOMICA_FIM()
+#define REG_ATOMICA_ANINHADA()	(0)
+#define REG_ATOMICA_ISR_INICIO(estado)
+#define REG_ATOMICA_ISR_FIM(estado)
+
+#define TROCA_CONTEXTO()		(sim_troca_solicitada = 1);
+#define TrocaContexto()			TROCA_CONTEXTO()
+
+#define GERA_INTERRUPCAO_SW()
+
+#define EM_INTERRUPCAO()		(0)
+
+#define REINICIA_SISTEMA()		__builtin_trap();
+
+#define LE_CONTADOR_CICLOS()		(0u)
+#define CICLOS_DECORRIDOS(ini, fim)	((ini) - (fim))
+
+#endif /* CPU_PORT_H_ */
@@ -0,0 +1,806 @@
+/*
+ * simulador.c
+ *
+ * Simulador de eventos discretos do sistema multitarefas.
+ *
+ * Executa no computador (host) o codigo real do kernel (rtos.c): escalonador(),
+ * ExecutaMarcaDeTempo(), TrocaContextoDasTarefas() e os servicos de tarefas e
+ * semaforos, sem realizar trocas de contexto reais. As tarefas sao substituidas
+ * por cargas sinteticas (tempos de execucao) e as interrupcoes por processos de
+ * chegada, o que permite simular horas de funcionamento em segundos e avaliar
+ * prioridades e frequencias de marca de tempo antes de gravar o firmware.
+ *
+ * Com a opcao -p, o shell de inspecao (shell.c) e conectado a entrada e a
+ * saida padrao depois da simulacao, no lugar da UART, e le comandos de um pipe
+ * ou do terminal: printf 'tarefas\nkernel\n' | simulador -p carga.txt
+ *
+ * Uso: simulador [opcoes] carga.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "rtos.h"
+#include "shell.h"
+
+#define MAX_NOME			32
+#define MAX_FONTES			8
+#define MAX_CHEGADAS		1024		/* chegadas de interrupcao ainda nao atendidas */
+#define NUM_CLASSES			4096		/* classes do histograma de tempos de resposta */
+
+typedef uint64_t ciclos_t;
+
+typedef enum {PERIODICA, APERIODICA} tipo_carga_t;
+
+/* fonte de interrupcoes que libera um semaforo, ou encadeamento entre duas
+   tarefas (a anterior libera o semaforo ao concluir cada trabalho) */
+typedef struct
+{
+	char		nome[MAX_NOME];
+	int			encadeada;			/* ativada pela tarefa anterior, sem interrupcao */
+	int			poisson;			/* 1: chegadas exponenciais, 0: periodicas */
+	double		intervalo_us;		/* intervalo medio entre chegadas */
+	ciclos_t	custo;				/* tempo de execucao da rotina de interrupcao */
+	ciclos_t	proxima;			/* instante da proxima chegada */
+	semaforo_t	semaforo;
+	ciclos_t	chegadas[MAX_CHEGADAS];	/* fila de instantes de chegada (tempo de liberacao dos trabalhos) */
+	unsigned	inicio, quantidade;
+	uint64_t	total, descartadas;
+} fonte_t;
+
+/* carga sintetica associada a uma tarefa do kernel */
+typedef struct
+{
+	char			nome[MAX_NOME];
+	tipo_carga_t	tipo;
+	prioridade_t	prioridade;
+	tick_t			periodo;			/* em marcas de tempo (periodicas) */
+	fonte_t			*fonte;				/* fonte de ativacao (aperiodicas) */
+	fonte_t			*saida;				/* ativa a proxima tarefa do encadeamento */
+	prioridade_t	limiar;				/* limiar de preempcao */
+	tick_t			orcamento, periodo_servidor;	/* servidor esporadico (orcamento 0: sem) */
+	double			exec_min_us, exec_max_us;
+	uint8_t			id;					/* indice no TCB */
+
+	ciclos_t		restante;			/* trabalho restante do trabalho atual */
+	ciclos_t		liberacao;			/* instante de liberacao do trabalho atual */
+	uint64_t		proxima_marca;		/* liberacao do proximo trabalho (periodicas) */
+	int				aguardando;			/* bloqueada esperando ativacao */
+	int				ativa;				/* tem trabalho em andamento */
+
+	uint64_t		trabalhos, prazos_perdidos;
+	ciclos_t		tempo_cpu;
+	ciclos_t		resposta_min, resposta_max;
+	double			resposta_soma;
+	uint64_t		histograma[NUM_CLASSES + 1];
+} carga_t;
+
+/* variavel usada pela porta host (cpu-port.h) */
+volatile uint8_t sim_troca_solicitada = 0;
+
+static carga_t		cargas[NUMERO_DE_TAREFAS];
+static int			numero_cargas = 0;
+static fonte_t		fontes[MAX_FONTES];
+static int			numero_fontes = 0;
+static uint8_t		id_ociosa = 0;
+static carga_t		*carga_por_id[NUMERO_DE_TAREFAS + 1];
+
+#define TAM_PILHA			(TAM_MINIMO_PILHA + cfg_PILHA_PALAVRAS_GUARDA)
+
+static uint32_t		pilhas[NUMERO_DE_TAREFAS + 1][TAM_PILHA];
+
+/* parametros da simulacao */
+static double		clock_hz = cfg_CPU_CLOCK_HZ;
+static double		marca_hz = cfg_MARCA_TEMPO_HZ;
+static double		duracao_s = 3600.0;
+static ciclos_t		custo_marca = 0;
+static ciclos_t		custo_troca = 0;
+static double		largura_classe_us = 10.0;
+static int			cooperativo = !cfg_PREEMPCAO_NA_MARCA;	/* modo do firmware */
+static int			ignora_limiar = 0;
+static int			ignora_servidor = 0;
+static int			usa_shell = 0;
+static uint64_t		semente = 1;
+
+/* estado da simulacao */
+static ciclos_t		agora = 0;
+static uint64_t		marcas = 0;
+static uint64_t		trocas_de_contexto = 0;
+static ciclos_t		tempo_ocioso = 0;
+static ciclos_t		tempo_sobrecarga = 0;
+
+/* funcoes do cpu-port.c do processador */
+
+/* a porta host nao monta o contexto inicial: as tarefas nao executam de fato */
+stackptr_t CriaContexto(tarefa_t endereco_tarefa, stackptr_t ptr_pilha)
+{
+	(void)endereco_tarefa;
+	return ptr_pilha;
+}
+
+/* a tarefa ociosa tambem nao executa: o tempo ocioso e contado pelo simulador */
+void OciosaDorme(tick_t marcas_livres)
+{
+	(void)marcas_livres;
+}
+
+/* gerador pseudoaleatorio xorshift64*, reprodutivel pela semente */
+static double aleatorio(void)
+{
+	semente ^= semente >> 12;
+	semente ^= semente << 25;
+	semente ^= semente >> 27;
+	return (double)((semente * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static ciclos_t us_para_ciclos(double us)
+{
+	return (ciclos_t)(us * clock_hz / 1e6 + 0.5);
+}
+
+static double ciclos_para_us(ciclos_t c)
+{
+	return (double)c * 1e6 / clock_hz;
+}
+
+static fonte_t *busca_fonte(const char *nome)
+{
+	int i;
+	for(i = 0; i < numero_fontes; i++)
+	{
+		if(!fontes[i].encadeada && strcmp(fontes[i].nome, nome) == 0)
+		{
+			return &fontes[i];
+		}
+	}
+	return NULL;
+}
+
+static carga_t *busca_carga(const char *nome)
+{
+	int i;
+	for(i = 0; i < numero_cargas; i++)
+	{
+		if(strcmp(cargas[i].nome, nome) == 0)
+		{
+			return &cargas[i];
+		}
+	}
+	return NULL;
+}
+
+/* prazo implicito: periodo para as periodicas, intervalo medio para as aperiodicas */
+static double prazo_us(const carga_t *carga)
+{
+	return carga->tipo == PERIODICA ? carga->periodo * 1e6 / marca_hz : carga->fonte->intervalo_us;
+}
+
+static void uso(const char *programa)
+{
+	fprintf(stderr,
+		"uso: %s [opcoes] carga.txt\n"
+		"  -d SEGUNDOS   tempo simulado (padrao 3600)\n"
+		"  -f HZ         frequencia de clock da CPU (padrao %d)\n"
+		"  -t HZ         frequencia da marca de tempo (padrao %d)\n"
+		"  -m CICLOS     custo da marca de tempo\n"
+		"  -x CICLOS     custo da troca de contexto\n"
+		"  -h US         largura das classes do histograma (padrao 10)\n"
+		"  -s SEMENTE    semente do gerador aleatorio\n"
+		"  -c            modo cooperativo: a marca de tempo nao solicita troca de contexto\n"
+		"                (padrao, como o firmware com cfg_PREEMPCAO_NA_MARCA = 0)\n"
+		"  -P            preempcao na marca de tempo (cfg_PREEMPCAO_NA_MARCA = 1)\n"
+		"  -L            ignora os limiares de preempcao da carga\n"
+		"  -S            ignora os servidores esporadicos da carga\n"
+		"  -p            shell de inspecao na entrada e saida padrao, depois da simulacao\n"
+		"\n"
+		"carga: uma declaracao por linha, tempos em microssegundos\n"
+		"  isr NOME poisson TAXA_HZ CUSTO_US\n"
+		"  isr NOME periodica PERIODO_US CUSTO_US\n"
+		"  tarefa NOME PRIORIDADE periodica PERIODO_MARCAS EXEC_MIN_US EXEC_MAX_US [LIMIAR]\n"
+		"  tarefa NOME PRIORIDADE isr FONTE EXEC_MIN_US EXEC_MAX_US [LIMIAR]\n"
+		"  tarefa NOME PRIORIDADE apos TAREFA EXEC_MIN_US EXEC_MAX_US [LIMIAR]\n"
+		"  servidor TAREFA ORCAMENTO_MARCAS PERIODO_MARCAS\n",
+		programa, cfg_CPU_CLOCK_HZ, cfg_MARCA_TEMPO_HZ);
+}
+
+static int le_carga(const char *arquivo)
+{
+	FILE *f = fopen(arquivo, "r");
+	char linha[256];
+	int num_linha = 0;
+
+	if(f == NULL)
+	{
+		perror(arquivo);
+		return -1;
+	}
+
+	while(fgets(linha, sizeof(linha), f) != NULL)
+	{
+		char tipo[16], nome[MAX_NOME], modo[16], arg[MAX_NOME];
+		double a, b, c;
+		unsigned prioridade, limiar;
+		int campos = 0, ok = 0;
+
+		num_linha++;
+		if(sscanf(linha, "%15s", tipo) != 1 || tipo[0] == '#')
+		{
+			continue;
+		}
+
+		if(strcmp(tipo, "isr") == 0 && numero_fontes < MAX_FONTES &&
+		   sscanf(linha, "%*s %31s %15s %lf %lf", nome, modo, &a, &b) == 4 && a > 0.0)
+		{
+			fonte_t *fonte = &fontes[numero_fontes++];
+			strcpy(fonte->nome, nome);
+			fonte->poisson = (strcmp(modo, "poisson") == 0);
+			fonte->intervalo_us = fonte->poisson ? 1e6 / a : a;
+			fonte->custo = us_para_ciclos(b);
+			ok = fonte->poisson || strcmp(modo, "periodica") == 0;
+		}
+		else if(strcmp(tipo, "tarefa") == 0 && numero_cargas < NUMERO_DE_TAREFAS - 1 &&
+				(campos = sscanf(linha, "%*s %31s %u %15s %31s %lf %lf %u",
+								 nome, &prioridade, modo, arg, &b, &c, &limiar)) >= 6 &&
+				prioridade > 0 && prioridade <= PRIORIDADE_MAXIMA && b >= 0.0 && c >= b &&
+				(campos == 6 || (limiar >= prioridade && limiar <= PRIORIDADE_MAXIMA)))
+		{
+			carga_t *carga = &cargas[numero_cargas];
+			strcpy(carga->nome, nome);
+			carga->prioridade = (prioridade_t)prioridade;
+			carga->limiar = (prioridade_t)(campos == 7 ? limiar : prioridade);
+			carga->exec_min_us = b;
+			carga->exec_max_us = c;
+			if(strcmp(modo, "periodica") == 0)
+			{
+				a = atof(arg);
+				carga->tipo = PERIODICA;
+				carga->periodo = (tick_t)a;
+				ok = (a >= 1.0 && a <= 65535.0);
+			}
+			else if(strcmp(modo, "isr") == 0)
+			{
+				carga->tipo = APERIODICA;
+				carga->fonte = busca_fonte(arg);
+				ok = (carga->fonte != NULL);
+			}
+			else if(strcmp(modo, "apos") == 0 && numero_fontes < MAX_FONTES)
+			{
+				/* ativada a cada trabalho concluido pela tarefa anterior, com o mesmo prazo */
+				carga_t *anterior = busca_carga(arg);
+				if(anterior != NULL && anterior->saida == NULL)
+				{
+					fonte_t *fonte = &fontes[numero_fontes++];
+					strcpy(fonte->nome, anterior->nome);
+					fonte->encadeada = 1;
+					fonte->intervalo_us = prazo_us(anterior);
+					anterior->saida = fonte;
+					carga->tipo = APERIODICA;
+					carga->fonte = fonte;
+					ok = 1;
+				}
+			}
+			numero_cargas++;
+		}
+		else if(strcmp(tipo, "servidor") == 0 &&
+				sscanf(linha, "%*s %31s %lf %lf", nome, &a, &b) == 3)
+		{
+			/* servidor esporadico para uma tarefa ja declarada */
+			carga_t *carga = busca_carga(nome);
+			if(carga != NULL && a >= 1.0 && a <= b && b < 32768.0)
+			{
+				carga->orcamento = (tick_t)a;
+				carga->periodo_servidor = (tick_t)b;
+				ok = 1;
+			}
+		}
+
+		if(!ok)
+		{
+			fprintf(stderr, "%s:%d: linha invalida\n", arquivo, num_linha);
+			fclose(f);
+			return -1;
+		}
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static ciclos_t sorteia_execucao(const carga_t *carga)
+{
+	double us = carga->exec_min_us + (carga->exec_max_us - carga->exec_min_us) * aleatorio();
+	return us_para_ciclos(us);
+}
+
+static void agenda_chegada(fonte_t *fonte)
+{
+	double intervalo = fonte->intervalo_us;
+	if(fonte->poisson)
+	{
+		intervalo = -log(1.0 - aleatorio()) * fonte->intervalo_us;
+	}
+	fonte->proxima += us_para_ciclos(intervalo) > 0 ? us_para_ciclos(intervalo) : 1;
+}
+
+static void registra_resposta(carga_t *carga)
+{
+	ciclos_t resposta = agora - carga->liberacao;
+	double us = ciclos_para_us(resposta);
+	unsigned classe = (unsigned)(us / largura_classe_us);
+
+	if(carga->trabalhos == 0 || resposta < carga->resposta_min)
+	{
+		carga->resposta_min = resposta;
+	}
+	if(resposta > carga->resposta_max)
+	{
+		carga->resposta_max = resposta;
+	}
+	carga->resposta_soma += us;
+	carga->histograma[classe < NUM_CLASSES ? classe : NUM_CLASSES]++;
+	carga->trabalhos++;
+
+	if(us > prazo_us(carga))
+	{
+		carga->prazos_perdidos++;
+		TarefaPrazoPerdido(carga->id);
+	}
+}
+
+/* guarda o instante de chegada, que sera o de liberacao do trabalho */
+static void registra_chegada(fonte_t *fonte, ciclos_t instante)
+{
+	if(fonte->quantidade < MAX_CHEGADAS)
+	{
+		fonte->chegadas[(fonte->inicio + fonte->quantidade) % MAX_CHEGADAS] = instante;
+		fonte->quantidade++;
+	}
+	else
+	{
+		fonte->descartadas++;
+	}
+	fonte->total++;
+}
+
+/* comportamento da tarefa ao concluir um trabalho: chama os servicos do kernel
+   como a tarefa real faria (espera pelo proximo periodo ou pelo semaforo) */
+static void conclui_trabalho(carga_t *carga)
+{
+	if(carga->ativa)
+	{
+		registra_resposta(carga);
+		carga->ativa = 0;
+
+		if(carga->saida != NULL)
+		{
+			/* ativa a proxima tarefa do encadeamento; a troca de contexto
+			   solicitada ocorre antes de a tarefa voltar a esperar */
+			registra_chegada(carga->saida, agora);
+			SemaforoLibera(&carga->saida->semaforo);
+			return;
+		}
+	}
+
+	if(carga->tipo == PERIODICA)
+	{
+		uint64_t liberacao = carga->proxima_marca;
+		carga->proxima_marca += carga->periodo;
+
+		if(liberacao > marcas)
+		{
+			TarefaEspera((tick_t)(liberacao - marcas));
+			carga->aguardando = 1;
+		}
+		else
+		{
+			/* periodo ja expirou: o proximo trabalho comeca atrasado */
+			carga->liberacao = (ciclos_t)((double)liberacao * clock_hz / marca_hz);
+			carga->restante = sorteia_execucao(carga);
+			carga->ativa = 1;
+		}
+	}
+	else
+	{
+		SemaforoAguarda(&carga->fonte->semaforo);
+		carga->aguardando = (TCB[carga->id].estado != PRONTA);
+		if(!carga->aguardando)
+		{
+			/* semaforo ja estava liberado: atende a proxima chegada da fila */
+			carga->restante = 0;
+			carga->aguardando = 1;
+		}
+	}
+}
+
+/* tarefa volta a executar apos ter sido bloqueada */
+static void inicia_trabalho(carga_t *carga)
+{
+	carga->aguardando = 0;
+	carga->ativa = 1;
+	carga->restante = sorteia_execucao(carga);
+
+	if(carga->tipo == PERIODICA)
+	{
+		carga->liberacao = (ciclos_t)((double)(carga->proxima_marca - carga->periodo) * clock_hz / marca_hz);
+	}
+	else
+	{
+		fonte_t *fonte = carga->fonte;
+		if(fonte->quantidade > 0)
+		{
+			carga->liberacao = fonte->chegadas[fonte->inicio];
+			fonte->inicio = (fonte->inicio + 1) % MAX_CHEGADAS;
+			fonte->quantidade--;
+		}
+		else
+		{
+			carga->liberacao = agora;	/* chegada descartada da fila */
+		}
+	}
+}
+
+static void troca_contexto(void)
+{
+	uint8_t anterior = tarefa_atual;
+
+	sim_troca_solicitada = 0;
+	TrocaContextoDasTarefas();
+	if(tarefa_atual != anterior)
+	{
+		trocas_de_contexto++;
+		agora += custo_troca;
+		tempo_sobrecarga += custo_troca;
+	}
+}
+
+static void executa_interrupcao(fonte_t *fonte)
+{
+	registra_chegada(fonte, fonte->proxima);
+
+	agora += fonte->custo;
+	tempo_sobrecarga += fonte->custo;
+	SemaforoLiberaISR(&fonte->semaforo);
+	FIM_DE_INTERRUPCAO();
+	agenda_chegada(fonte);
+}
+
+static void executa_marca(void)
+{
+	agora += custo_marca;
+	tempo_sobrecarga += custo_marca;
+	marcas++;
+	ExecutaMarcaDeTempo();
+
+	/* no modo cooperativo apenas a tarefa ociosa cede o processador */
+	if(!cooperativo || tarefa_atual == id_ociosa)
+	{
+		sim_troca_solicitada = 1;
+	}
+}
+
+static void simula(void)
+{
+	ciclos_t fim = us_para_ciclos(duracao_s * 1e6);
+	double ciclos_por_marca = clock_hz / marca_hz;
+	ciclos_t proxima_marca = (ciclos_t)ciclos_por_marca;
+	int i;
+
+	while(agora < fim)
+	{
+		carga_t *carga = carga_por_id[tarefa_atual];
+		fonte_t *fonte = NULL;
+		ciclos_t evento = proxima_marca;
+
+		for(i = 0; i < numero_fontes; i++)
+		{
+			if(fontes[i].proxima < evento)
+			{
+				evento = fontes[i].proxima;
+				fonte = &fontes[i];
+			}
+		}
+
+		if(carga != NULL && carga->aguardando)
+		{
+			/* tarefa que estava bloqueada foi escolhida pelo escalonador */
+			inicia_trabalho(carga);
+		}
+
+		if(carga != NULL && carga->restante == 0)
+		{
+			conclui_trabalho(carga);
+		}
+		else if(evento > agora)
+		{
+			ciclos_t janela = evento - agora;
+			if(carga != NULL)
+			{
+				if(carga->restante < janela)
+				{
+					janela = carga->restante;
+				}
+				carga->restante -= janela;
+				carga->tempo_cpu += janela;
+			}
+			else
+			{
+				tempo_ocioso += janela;
+			}
+			agora += janela;
+		}
+
+		if(agora >= evento)
+		{
+			if(fonte != NULL)
+			{
+				executa_interrupcao(fonte);
+			}
+			else
+			{
+				executa_marca();
+				proxima_marca = (ciclos_t)((double)(marcas + 1) * ciclos_por_marca);
+			}
+		}
+
+		if(sim_troca_solicitada)
+		{
+			troca_contexto();
+		}
+	}
+}
+
+/* limite superior da classe do histograma que contem o percentil, limitado ao
+   maior tempo observado (a classe do maximo pode terminar depois dele) */
+static double percentil(const carga_t *carga, double p)
+{
+	uint64_t alvo = (uint64_t)ceil(p * (double)carga->trabalhos);
+	uint64_t acumulado = 0;
+	double maximo = ciclos_para_us(carga->resposta_max);
+	unsigned classe;
+
+	for(classe = 0; classe < NUM_CLASSES; classe++)
+	{
+		acumulado += carga->histograma[classe];
+		if(acumulado >= alvo && acumulado > 0)
+		{
+			double limite = (classe + 1) * largura_classe_us;
+			return limite < maximo ? limite : maximo;
+		}
+	}
+	/* classe de transbordamento, acima da ultima classe */
+	return carga->trabalhos > 0 ? maximo : 0.0;
+}
+
+static void relatorio(double segundos_reais)
+{
+	double total = (double)agora;
+	int i;
+
+	printf("tempo simulado: %.1f s em %.2f s (%llu marcas de tempo, %llu trocas de contexto)\n",
+		   total / clock_hz, segundos_reais, (unsigned long long)marcas,
+		   (unsigned long long)trocas_de_contexto);
+	printf("ocioso: %.1f%%  sobrecarga (marca, interrupcoes, trocas): %.1f%%\n\n",
+		   100.0 * (double)tempo_ocioso / total, 100.0 * (double)tempo_sobrecarga / total);
+
+	printf("tempos de resposta em us (percentis com resolucao de %.0f us)\n", largura_classe_us);
+	printf("%-12s %4s %4s %10s %6s %9s %9s %9s %9s %9s %9s %8s\n",
+		   "tarefa", "prio", "lim", "trabalhos", "cpu%", "min", "media", "p50", "p99", "p99.9", "max", "perdidos");
+
+	for(i = 0; i < numero_cargas; i++)
+	{
+		carga_t *carga = &cargas[i];
+		double media = carga->trabalhos ? carga->resposta_soma / (double)carga->trabalhos : 0.0;
+
+		printf("%-12s %4u %4u %10llu %6.1f %9.1f %9.1f %9.0f %9.0f %9.0f %9.1f %8llu\n",
+			   carga->nome, carga->prioridade, ignora_limiar ? carga->prioridade : carga->limiar,
+			   (unsigned long long)carga->trabalhos,
+			   100.0 * (double)carga->tempo_cpu / total,
+			   ciclos_para_us(carga->resposta_min), media,
+			   percentil(carga, 0.5), percentil(carga, 0.99), percentil(carga, 0.999),
+			   ciclos_para_us(carga->resposta_max), (unsigned long long)carga->prazos_perdidos);
+	}
+
+	for(i = 0; i < numero_cargas; i++)
+	{
+		if(cargas[i].orcamento > 0 && !ignora_servidor)
+		{
+			printf("\nservidor %s: %u marcas a cada %u, orcamento esgotado %u vezes\n",
+				   cargas[i].nome, cargas[i].orcamento, cargas[i].periodo_servidor,
+				   ServidorEsgotamentos(cargas[i].id));
+		}
+	}
+
+	for(i = 0; i < numero_fontes; i++)
+	{
+		if(fontes[i].descartadas > 0)
+		{
+			printf("\n%s %s: %llu de %llu chegadas sem registro de tempo (fila cheia)\n",
+				   fontes[i].encadeada ? "apos" : "isr", fontes[i].nome, (unsigned long long)fontes[i].descartadas,
+				   (unsigned long long)fontes[i].total);
+		}
+	}
+}
+
+/* backend do shell sobre a entrada e a saida padrao (pipe ou terminal) */
+static int fim_da_entrada = 0;
+
+static int16_t le_entrada(void)
+{
+	unsigned char c;
+	ssize_t lidos = read(STDIN_FILENO, &c, 1);
+
+	if(lidos == 1)
+	{
+		return c;
+	}
+	if(lidos == 0)
+	{
+		fim_da_entrada = 1;
+	}
+	return -1;
+}
+
+static void escreve_saida(const char *linha)
+{
+	puts(linha);
+	fflush(stdout);
+}
+
+static const shell_backend_t backend_pipe = { le_entrada, escreve_saida };
+
+/* executa o shell como a tarefa do shell faria, ate o fim da entrada */
+static void executa_shell(void)
+{
+	fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+	ShellConecta(&backend_pipe);
+
+	printf("\nshell (ajuda: lista os comandos)\n");
+	fflush(stdout);
+	while(ShellExecuta() || !fim_da_entrada)
+	{
+		if(!fim_da_entrada)
+		{
+			usleep(1000);		/* sem comando: espera, como TarefaEspera() */
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	clock_t inicio;
+	int i;
+
+	for(i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if(strcmp(argv[i], "-c") == 0)
+		{
+			cooperativo = 1;
+		}
+		else if(strcmp(argv[i], "-P") == 0)
+		{
+			cooperativo = 0;
+		}
+		else if(strcmp(argv[i], "-L") == 0)
+		{
+			ignora_limiar = 1;
+		}
+		else if(strcmp(argv[i], "-S") == 0)
+		{
+			ignora_servidor = 1;
+		}
+		else if(strcmp(argv[i], "-p") == 0)
+		{
+			usa_shell = 1;
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "-d") == 0)
+		{
+			duracao_s = atof(argv[++i]);
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "-f") == 0)
+		{
+			clock_hz = atof(argv[++i]);
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "-t") == 0)
+		{
+			marca_hz = atof(argv[++i]);
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "-m") == 0)
+		{
+			custo_marca = (ciclos_t)atof(argv[++i]);
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "-x") == 0)
+		{
+			custo_troca = (ciclos_t)atof(argv[++i]);
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "-h") == 0)
+		{
+			largura_classe_us = atof(argv[++i]);
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "-s") == 0)
+		{
+			semente = strtoull(argv[++i], NULL, 0);
+		}
+		else
+		{
+			uso(argv[0]);
+			return 2;
+		}
+	}
+
+	if(i != argc - 1 || clock_hz <= 0.0 || marca_hz <= 0.0 || largura_classe_us <= 0.0 || semente == 0)
+	{
+		uso(argv[0]);
+		return 2;
+	}
+
+	if(le_carga(argv[i]) != 0)
+	{
+		return 2;
+	}
+
+	/* cria as tarefas no kernel, como em main() do firmware */
+	for(i = 0; i < numero_cargas; i++)
+	{
+		carga_t *carga = &cargas[i];
+
+		if(Prioridades[carga->prioridade] != 0)
+		{
+			fprintf(stderr, "%s: prioridade %u ja utilizada\n", carga->nome, carga->prioridade);
+			return 2;
+		}
+		CriaTarefa((tarefa_t)NULL, carga->nome, pilhas[i], TAM_PILHA, carga->prioridade);
+		carga->id = Prioridades[carga->prioridade];
+		carga_por_id[carga->id] = carga;
+		if(!ignora_limiar)
+		{
+			TarefaDefineLimiar(carga->id, carga->limiar);
+		}
+		if(carga->orcamento > 0 && !ignora_servidor &&
+		   TarefaDefineServidor(carga->id, carga->orcamento, carga->periodo_servidor) != STATUS_OK)
+		{
+			fprintf(stderr, "%s: mais servidores que cfg_SERVIDORES\n", carga->nome);
+			return 2;
+		}
+
+		/* primeira ativacao: periodicas liberadas na marca 0, aperiodicas
+		   executam ate o primeiro SemaforoAguarda() */
+		carga->ativa = (carga->tipo == PERIODICA);
+		carga->restante = carga->ativa ? sorteia_execucao(carga) : 0;
+		carga->proxima_marca = carga->periodo;
+	}
+	CriaTarefa(tarefa_ociosa, "Tarefa ociosa", pilhas[numero_cargas], TAM_PILHA, 0);
+	id_ociosa = Prioridades[0];
+
+	for(i = 0; i < numero_fontes; i++)
+	{
+		fontes[i].proxima = 0;
+		if(fontes[i].encadeada)
+		{
+			fontes[i].proxima = UINT64_MAX;	/* sem interrupcao */
+		}
+		else
+		{
+			agenda_chegada(&fontes[i]);
+		}
+		SemaforoRegistra(&fontes[i].semaforo, fontes[i].nome);
+	}
+
+	IniciaMultitarefas();
+
+	inicio = clock();
+	simula();
+	relatorio((double)(clock() - inicio) / CLOCKS_PER_SEC);
+
+	if(usa_shell)
+	{
+		executa_shell();
+	}
+
+	return 0;
+}